@@ -0,0 +1,300 @@
+// Latency of the barn path planners from the samples on generated layouts.
+// Layouts, starts and goals come from fixed seeds and the plans run without a
+// clock budget, so every run plans the same queries and finds the same paths.
+// Latencies are as fine as b2Timer, plans/s times each pass as a whole.
+
+#include "grid_planner.h"
+#include "hierarchical_planner.h"
+#include "mapmaker.h"
+#include "random_stream.h"
+#include "rrt.h"
+#include "visibility_planner.h"
+
+#include "box2d/box2d.h"
+#include "box2d/math_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+struct PlannerCase
+{
+	const char *name;
+	planner_engine engine;
+	rrt_mode mode; // RRT only
+};
+
+struct Query
+{
+	b2Vec2 start;
+	b2Vec2 goal;
+	int area; // layout index of the goal, the flow field index
+	std::vector<std::pair<int, int>> goalCells; // free sides of the area, like Cow::RunPlanner
+	std::vector<b2Vec2> goalPoints;
+};
+
+struct CaseResult
+{
+	float plansPerSecond;
+	float p50;
+	float p99;
+	float expanded;
+	float length;
+	float found;
+};
+
+// Areas of random type dropped on free cells until they cover density of the barn
+static std::vector<SampleFunctionalArea> MakeLayout(int size, float density, uint64_t seed)
+{
+	RandomStream random(seed);
+	std::vector<std::vector<bool>> used(size, std::vector<bool>(size, false));
+	std::vector<SampleFunctionalArea> layout;
+
+	int target = int(density * size * size);
+	int covered = 0;
+	for (int attempt = 0; covered < target && attempt < 100 * size * size; ++attempt)
+	{
+		SampleFunctionalArea area;
+		area.type = random.NextInt(7);
+		area.orientation = random.NextInt(3);
+		int x = random.NextInt(size);
+		int y = random.NextInt(size);
+		int x2 = area.orientation == 2 ? x + 1 : x;
+		int y2 = area.orientation == 1 ? y + 1 : y;
+		if (x2 >= size || y2 >= size || used[x][y] || used[x2][y2])
+		{
+			continue;
+		}
+
+		used[x][y] = true;
+		used[x2][y2] = true;
+		covered += area.orientation == 0 ? 1 : 2;
+		area.x = float(x);
+		area.y = float(y);
+		layout.push_back(area);
+	}
+	return layout;
+}
+
+static float Percentile(std::vector<float> &values, float fraction)
+{
+	size_t index = std::min(values.size() - 1, size_t(fraction * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+int main(int argc, char **argv)
+{
+	int queryCount = 256;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (strncmp(arg, "-q=", 3) == 0)
+		{
+			queryCount = b2MaxInt(atoi(arg + 3), 1);
+		}
+		else if (strcmp(arg, "-h") == 0)
+		{
+			printf("Usage\n"
+				   "-q=<query count>: start and goal pairs planned per layout\n");
+		}
+	}
+
+	PlannerCase cases[] = {
+		{"rrt_uniform", engine_rrt, rrt_uniform},
+		{"rrt_goal_biased", engine_rrt, rrt_goal_biased},
+		{"rrt_connect", engine_rrt, rrt_connect},
+		{"rrt_star", engine_rrt, rrt_star},
+		{"grid_astar", engine_astar, rrt_goal_biased},
+		{"grid_jps", engine_jps, rrt_goal_biased},
+		{"flow_field", engine_flow, rrt_goal_biased},
+		{"visibility", engine_visibility, rrt_goal_biased},
+		{"hpa_star", engine_hierarchical, rrt_goal_biased},
+	};
+	const int caseCount = sizeof(cases) / sizeof(cases[0]);
+
+	// The canvas goes up to 100 x 100 cells
+	int sizes[] = {20, 50, 100};
+	float densities[] = {0.1f, 0.25f};
+	const int sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+	const int densityCount = sizeof(densities) / sizeof(densities[0]);
+
+	// Same settings as the cows, see Cow::RunPlanner
+	const float clearance = 11.0f;
+	const float stepSize = 24.0f;
+	const float goalThreshold = 56.0f;
+	PlanBudget budget;
+	budget.max_milliseconds = 0.0f;
+	budget.max_iterations = 5000; // the 4 ms of the cows stop RRT well before this on the large barns
+
+	RRT rrt;
+	GridPlanner grid;
+	VisibilityPlanner visibility;
+	HierarchicalPlanner hierarchical;
+
+	FILE *file = fopen("planner.csv", "w");
+	if (file != nullptr)
+	{
+		fprintf(file, "size,density,engine,plans_per_s,p50_us,p99_us,expanded,length,found\n");
+	}
+
+	printf("Starting planner benchmark\n");
+	printf("======================================\n");
+
+	for (int sizeIndex = 0; sizeIndex < sizeCount; ++sizeIndex)
+	{
+		for (int densityIndex = 0; densityIndex < densityCount; ++densityIndex)
+		{
+			int size = sizes[sizeIndex];
+			float density = densities[densityIndex];
+			uint64_t layoutSeed = MixSeed(42, uint64_t(sizeIndex * densityCount + densityIndex));
+
+			b2Timer buildTimer = b2CreateTimer();
+			MapMaker map;
+			map.layout = MakeLayout(size, density, layoutSeed);
+			map.corner_layout = {size, size};
+			map.clearance = clearance;
+			for (const SampleFunctionalArea &area : map.layout)
+			{
+				map.cow_aabbs.push_back(map.AreaAABB(area));
+			}
+			map.CreateCowMap();
+			map.CreateGridMap();
+			map.CreateFlowFields();
+			map.CreateChunkGraph();
+			map.CreateVisibilityGraph();
+			float buildMs = b2GetMilliseconds(&buildTimer);
+
+			// Starts where a cow could spawn, goals on the anchor cell of an area like Cow::Get_target
+			RandomStream random(MixSeed(layoutSeed, uint64_t(-1)));
+			b2Vec2 barnSize = {size * 24.0f, size * 24.0f};
+			std::vector<Query> queries(queryCount);
+			for (Query &query : queries)
+			{
+				do
+				{
+					query.start = {random.NextFloat(0.0f, barnSize.x), random.NextFloat(0.0f, barnSize.y)};
+				}
+				while (map.obstacle_index.PointBlocked(query.start, 42.0f - clearance));
+
+				query.area = random.NextInt(int(map.layout.size()));
+				const SampleFunctionalArea &area = map.layout[query.area];
+				query.goal = {area.x * 24.0f + 12.0f, area.y * 24.0f + 12.0f};
+				map.occupancy.FindSideCells(AreaCells(area), query.goalCells);
+				for (const std::pair<int, int> &cell : query.goalCells)
+				{
+					query.goalPoints.push_back(map.occupancy.CellCenter(cell.first, cell.second));
+				}
+			}
+
+			printf("barn: %d x %d, density = %g, areas = %d, boxes = %d, build = %g (ms)\n", size, size, density,
+				   int(map.layout.size()), int(map.inflated_map.size()), buildMs);
+
+			for (int caseIndex = 0; caseIndex < caseCount; ++caseIndex)
+			{
+				const PlannerCase &plannerCase = cases[caseIndex];
+				rrt.mode = plannerCase.mode;
+
+				std::vector<float> latencies(queryCount);
+				long long expanded = 0;
+				double length = 0.0;
+				int found = 0;
+				float totalMs = 0.0f;
+
+				// The first pass grows the scratch to its working size, the second is timed
+				for (int pass = 0; pass < 2; ++pass)
+				{
+					b2Timer passTimer = b2CreateTimer();
+					for (int queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+					{
+						const Query &query = queries[queryIndex];
+						rrt.random.Seed(MixSeed(layoutSeed, uint64_t(queryIndex)));
+
+						b2Timer timer = b2CreateTimer();
+						PlanResult result;
+						switch (plannerCase.engine)
+						{
+							case engine_rrt:
+								result = rrt.FindPath(query.start, query.goal, &map.obstacle_index, barnSize, stepSize,
+													  goalThreshold, budget);
+								break;
+							case engine_astar:
+							case engine_jps:
+								result = grid.FindPath(query.start, query.goalCells, map.occupancy,
+													   plannerCase.engine == engine_jps, budget);
+								break;
+							case engine_flow:
+							{
+								b2Vec2 waypoint;
+								if (map.flow_fields.NextWaypoint(query.area, query.start, &waypoint) != flow_lost)
+								{
+									result.status = plan_found;
+								}
+								break;
+							}
+							case engine_visibility:
+								result = visibility.FindPath(query.start, query.goalPoints, map.visibility, budget);
+								break;
+							case engine_hierarchical:
+								result = hierarchical.FindPath(query.start, query.goalCells, map.chunk_graph, budget);
+								break;
+							default:
+								break;
+						}
+						float ms = b2GetMilliseconds(&timer);
+
+						// The plans are the same on both passes, the untimed one keeps the counts
+						if (pass == 1)
+						{
+							latencies[queryIndex] = 1000.0f * ms;
+							continue;
+						}
+
+						expanded += result.iterations;
+						if (result.status == plan_found)
+						{
+							found += 1;
+							length += plannerCase.engine == engine_flow
+										  ? map.flow_fields.RouteLength(query.area, query.start)
+										  : PathLength(result.path);
+						}
+					}
+					totalMs = b2GetMilliseconds(&passTimer);
+				}
+
+				CaseResult r;
+				r.plansPerSecond = totalMs > 0.0f ? 1000.0f * queryCount / totalMs : 0.0f;
+				r.p50 = Percentile(latencies, 0.5f);
+				r.p99 = Percentile(latencies, 0.99f);
+				r.expanded = float(expanded) / queryCount;
+				r.length = found > 0 ? float(length / found) : 0.0f;
+				r.found = float(found) / queryCount;
+
+				printf("%-16s: %10.1f (plans/s), p50 = %8.2f (us), p99 = %8.2f (us), expanded = %8.1f, length = %7.1f, "
+					   "found = %.2f\n",
+					   plannerCase.name, r.plansPerSecond, r.p50, r.p99, r.expanded, r.length, r.found);
+
+				if (file != nullptr)
+				{
+					fprintf(file, "%d,%g,%s,%g,%g,%g,%g,%g,%g\n", size, density, plannerCase.name, r.plansPerSecond,
+							r.p50, r.p99, r.expanded, r.length, r.found);
+				}
+			}
+			printf("\n");
+		}
+	}
+
+	if (file != nullptr)
+	{
+		fclose(file);
+	}
+
+	printf("======================================\n");
+	printf("Planner benchmark complete!\n");
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+// Throughput of the planner segment vs AABB kernels from the samples:
+// scalar, SSE2 (4 wide) and AVX2 (8 wide).
+
+#include "segment_kernel.h"
+
+#include "box2d/box2d.h"
+#include "box2d/math_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+typedef bool KernelFcn(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+					   const float *upper_y, int count);
+
+struct Kernel
+{
+	const char *name;
+	KernelFcn *fcn;
+};
+
+static float RandomFloat(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+int main(int argc, char **argv)
+{
+	int segmentCount = 1 << 18;
+	int runCount = 4;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (strncmp(arg, "-s=", 3) == 0)
+		{
+			segmentCount = atoi(arg + 3);
+		}
+		else if (strcmp(arg, "-h") == 0)
+		{
+			printf("Usage\n"
+				   "-s=<segment count>: segments tested per run\n");
+		}
+	}
+
+	Kernel kernels[] = {
+		{"scalar", SegmentHitsScalar},
+		{"sse2", SegmentHitsSSE2},
+		{"avx2", SegmentHitsAVX2},
+	};
+	const int kernelCount = sizeof(kernels) / sizeof(kernels[0]);
+
+	// Merged barn layouts have tens to hundreds of boxes
+	int obstacleCounts[] = {8, 32, 128, 512};
+	const int sizeCount = sizeof(obstacleCounts) / sizeof(obstacleCounts[0]);
+	float throughput[sizeCount][kernelCount] = {};
+
+	printf("Starting segment kernel benchmark\n");
+	printf("======================================\n");
+
+	for (int sizeIndex = 0; sizeIndex < sizeCount; ++sizeIndex)
+	{
+		srand(42);
+
+		// Sparse boxes and short segments so most tests scan every box
+		std::vector<b2AABB> aabbs(obstacleCounts[sizeIndex]);
+		for (b2AABB &aabb : aabbs)
+		{
+			b2Vec2 lower = {RandomFloat(0.0f, 2400.0f), RandomFloat(0.0f, 2400.0f)};
+			aabb = {lower, b2Add(lower, {24.0f, 48.0f})};
+		}
+
+		AABBSoA bounds;
+		bounds.Assign(aabbs);
+
+		std::vector<SegmentQuery> segments(segmentCount);
+		for (SegmentQuery &segment : segments)
+		{
+			b2Vec2 from = {RandomFloat(0.0f, 2400.0f), RandomFloat(0.0f, 2400.0f)};
+			b2Rot direction = b2MakeRot(RandomFloat(-b2_pi, b2_pi));
+			b2Vec2 to = b2MulAdd(from, 24.0f, {direction.c, direction.s});
+			segment = MakeSegmentQuery(from, to);
+		}
+
+		printf("obstacles: %d, segments = %d\n", obstacleCounts[sizeIndex], segmentCount);
+
+		int referenceHits = -1;
+		for (int kernelIndex = 0; kernelIndex < kernelCount; ++kernelIndex)
+		{
+			for (int runIndex = 0; runIndex < runCount; ++runIndex)
+			{
+				b2Timer timer = b2CreateTimer();
+
+				int hits = 0;
+				for (const SegmentQuery &segment : segments)
+				{
+					hits += kernels[kernelIndex].fcn(segment, bounds.lower_x.data(), bounds.lower_y.data(),
+													 bounds.upper_x.data(), bounds.upper_y.data(), bounds.padded_count);
+				}
+
+				float ms = b2GetMilliseconds(&timer);
+				float segmentsPerMs = segmentCount / ms;
+				printf("%s run %d : %g (ms), %g (segments/ms), %d hits\n", kernels[kernelIndex].name, runIndex, ms,
+					   segmentsPerMs, hits);
+
+				throughput[sizeIndex][kernelIndex] = b2MaxFloat(throughput[sizeIndex][kernelIndex], segmentsPerMs);
+
+				// Every kernel has to agree with the scalar reference
+				if (referenceHits == -1)
+				{
+					referenceHits = hits;
+				}
+				else if (hits != referenceHits)
+				{
+					printf("kernel %s disagrees: %d vs %d hits\n", kernels[kernelIndex].name, hits, referenceHits);
+					return 1;
+				}
+			}
+		}
+		printf("\n");
+	}
+
+	FILE *file = fopen("segment_kernel.csv", "w");
+	if (file != nullptr)
+	{
+		fprintf(file, "obstacles,scalar,sse2,avx2\n");
+		for (int sizeIndex = 0; sizeIndex < sizeCount; ++sizeIndex)
+		{
+			fprintf(file, "%d,%g,%g,%g\n", obstacleCounts[sizeIndex], throughput[sizeIndex][0], throughput[sizeIndex][1],
+					throughput[sizeIndex][2]);
+		}
+		fclose(file);
+	}
+
+	printf("======================================\n");
+	printf("Segment kernel benchmark complete!\n");
+
+	return 0;
+}
@@ -232,6 +232,31 @@ B2_API void b2Body_SetLinearVelocity( b2BodyId bodyId, b2Vec2 linearVelocity );
 /// Set the angular velocity of a body in radians per second
 B2_API void b2Body_SetAngularVelocity( b2BodyId bodyId, float angularVelocity );
 
+/// Get the world transforms of many bodies at once. Cheaper than calling b2Body_GetTransform
+/// for each body because the world is looked up once.
+///	@param bodyIds the bodies, all from the same world
+///	@param transforms receives one transform per body
+///	@param count the number of bodies
+B2_API void b2Body_GetTransforms( const b2BodyId* bodyIds, b2Transform* transforms, int count );
+
+/// Get the linear and angular velocities of many bodies at once. Bodies that are not awake
+/// report zero, like b2Body_GetLinearVelocity and b2Body_GetAngularVelocity.
+///	@param bodyIds the bodies, all from the same world
+///	@param linearVelocities receives one linear velocity per body, may be NULL
+///	@param angularVelocities receives one angular velocity per body, may be NULL
+///	@param count the number of bodies
+B2_API void b2Body_GetVelocities( const b2BodyId* bodyIds, b2Vec2* linearVelocities, float* angularVelocities, int count );
+
+/// Set the linear and angular velocities of many bodies at once. Same as calling
+/// b2Body_SetLinearVelocity and b2Body_SetAngularVelocity for each body, so a non-zero
+/// velocity wakes the body.
+///	@param bodyIds the bodies, all from the same world
+///	@param linearVelocities one linear velocity per body
+///	@param angularVelocities one angular velocity per body
+///	@param count the number of bodies
+B2_API void b2Body_SetVelocities( const b2BodyId* bodyIds, const b2Vec2* linearVelocities, const float* angularVelocities,
+								  int count );
+
 /// Apply a force at a world point. If the force is not applied at the center of mass,
 /// it will generate a torque and affect the angular velocity. This optionally wakes up the body.
 ///	The force is ignored if the body is not awake.
@@ -432,8 +432,10 @@ typedef struct b2Counters
 {
 	int32_t staticBodyCount;
 	int32_t bodyCount;
+	int32_t awakeBodyCount;
 	int32_t shapeCount;
 	int32_t contactCount;
+	int32_t awakeContactCount;
 	int32_t jointCount;
 	int32_t islandCount;
 	int32_t stackUsed;
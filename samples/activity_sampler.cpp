@@ -0,0 +1,131 @@
+#include "activity_sampler.h"
+
+#include <assert.h>
+
+// Random numbers
+std::vector<std::vector<float>> TRANSITION_MATRIX = {
+    {0.33f, 0.29f, 0.04f, 0.45f, 0.94f}, // Cubicle
+    {0.16f, 0.59f, 0.28f, 0.01f, 0.68f}, // Milker
+    {0.51f, 0.48f, 0.33f, 0.69f, 0.17f}, // Feeder
+    {0.29f, 0.28f, 0.11f, 0.98f, 0.79f}, // Concentrate
+    {0.73f, 0.50f, 0.73f, 0.50f, 0.73f}, // Drinker
+};
+
+ActivitySampler::ActivitySampler()
+{
+    m_activityCount = 0;
+}
+
+void ActivitySampler::Build(const std::vector<SampleFunctionalArea> &layout)
+{
+    m_activityCount = int(TRANSITION_MATRIX.size());
+
+    // Areas grouped by type, docking stations and obstacles are no activity
+    m_areaOffsets.assign(m_activityCount + 1, 0);
+    for (const SampleFunctionalArea &area : layout)
+    {
+        if (0 <= area.type && area.type < m_activityCount)
+        {
+            m_areaOffsets[area.type + 1] += 1;
+        }
+    }
+    for (int a = 0; a < m_activityCount; ++a)
+    {
+        m_areaOffsets[a + 1] += m_areaOffsets[a];
+    }
+
+    m_areas.resize(m_areaOffsets[m_activityCount]);
+    std::vector<int> fill(m_areaOffsets.begin(), m_areaOffsets.end() - 1);
+    for (int i = 0; i < int(layout.size()); ++i)
+    {
+        int type = layout[i].type;
+        if (0 <= type && type < m_activityCount)
+        {
+            m_areas[fill[type]++] = i;
+        }
+    }
+
+    // Rows without a single reachable activity sample -1
+    m_tables.assign(m_activityCount * m_activityCount, {0.0f, -1});
+    std::vector<float> scaled(m_activityCount);
+    std::vector<int> small;
+    std::vector<int> large;
+    for (int row = 0; row < m_activityCount; ++row)
+    {
+        float total = 0.0f;
+        for (int a = 0; a < m_activityCount; ++a)
+        {
+            bool present = m_areaOffsets[a + 1] > m_areaOffsets[a];
+            scaled[a] = present ? TRANSITION_MATRIX[row][a] : 0.0f;
+            total += scaled[a];
+        }
+        if (total <= 0.0f)
+        {
+            continue;
+        }
+
+        // Vose: pair each column below the mean with one above it
+        small.clear();
+        large.clear();
+        for (int a = 0; a < m_activityCount; ++a)
+        {
+            scaled[a] *= m_activityCount / total;
+            (scaled[a] < 1.0f ? small : large).push_back(a);
+        }
+
+        Entry *entries = &m_tables[row * m_activityCount];
+        while (!small.empty() && !large.empty())
+        {
+            int less = small.back();
+            small.pop_back();
+            int more = large.back();
+
+            entries[less] = {scaled[less], more};
+            scaled[more] -= 1.0f - scaled[less];
+            if (scaled[more] < 1.0f)
+            {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+
+        // What is left is one up to rounding
+        for (int a : large)
+        {
+            entries[a] = {1.0f, a};
+        }
+        for (int a : small)
+        {
+            entries[a] = {1.0f, a};
+        }
+    }
+}
+
+void ActivitySampler::Clear()
+{
+    m_activityCount = 0;
+    m_tables.clear();
+    m_areaOffsets.clear();
+    m_areas.clear();
+}
+
+int ActivitySampler::NextActivity(int activity, RandomStream &random) const
+{
+    if (activity < 0 || activity >= m_activityCount)
+    {
+        return -1;
+    }
+
+    int column = random.NextInt(m_activityCount);
+    const Entry &entry = m_tables[activity * m_activityCount + column];
+    return random.NextFloat() < entry.probability ? column : entry.alias;
+}
+
+int ActivitySampler::PickArea(int activity, RandomStream &random) const
+{
+    assert(0 <= activity && activity < m_activityCount);
+    int begin = m_areaOffsets[activity];
+    int count = m_areaOffsets[activity + 1] - begin;
+    assert(count > 0);
+    return m_areas[begin + random.NextInt(count)];
+}
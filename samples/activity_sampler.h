@@ -0,0 +1,39 @@
+#pragma once
+
+#include "barn_layout.h"
+#include "random_stream.h"
+
+#include <vector>
+
+// Next activity and target area for the cows of one layout. Each row of the
+// transition matrix keeps only the activities the layout has an area for and is
+// turned into an alias table (Vose), so a transition is two draws and one lookup,
+// with no retries and no allocation. Rebuild it whenever the layout changes.
+class ActivitySampler
+{
+public:
+    ActivitySampler();
+
+    void Build(const std::vector<SampleFunctionalArea> &layout);
+    void Clear();
+
+    // -1 when the layout has no area for any activity reachable from activity
+    int NextActivity(int activity, RandomStream &random) const;
+
+    // Layout index of an area of the activity, uniform over the areas of that type
+    int PickArea(int activity, RandomStream &random) const;
+
+    int GetActivityCount() const { return m_activityCount; }
+
+private:
+    struct Entry
+    {
+        float probability; // keep the column below this, take the alias above
+        int alias;
+    };
+
+    int m_activityCount;
+    std::vector<Entry> m_tables;    // one row of m_activityCount entries per activity
+    std::vector<int> m_areaOffsets; // areas of activity a are m_areas[m_areaOffsets[a], m_areaOffsets[a + 1])
+    std::vector<int> m_areas;
+};
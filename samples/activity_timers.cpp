@@ -0,0 +1,63 @@
+#include "activity_timers.h"
+
+#include <algorithm>
+#include <assert.h>
+
+ActivityTimers::ActivityTimers()
+{
+    m_pending = 0;
+}
+
+void ActivityTimers::Schedule(int cow, int step)
+{
+    assert(cow >= 0);
+    if (cow >= int(m_tickets.size()))
+    {
+        m_tickets.resize(cow + 1, 0);
+        m_live.resize(cow + 1, false);
+    }
+
+    Cancel(cow);
+    m_live[cow] = true;
+    m_pending += 1;
+    m_heap.push_back({step, cow, m_tickets[cow]});
+    std::push_heap(m_heap.begin(), m_heap.end(), Later);
+}
+
+void ActivityTimers::Cancel(int cow)
+{
+    if (cow < int(m_live.size()) && m_live[cow])
+    {
+        m_tickets[cow] += 1;
+        m_live[cow] = false;
+        m_pending -= 1;
+    }
+}
+
+void ActivityTimers::Clear()
+{
+    m_heap.clear();
+    m_tickets.clear();
+    m_live.clear();
+    m_pending = 0;
+}
+
+void ActivityTimers::PopDue(int step, std::vector<int> &cows)
+{
+    while (!m_heap.empty() && m_heap.front().step <= step)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), Later);
+        Timer timer = m_heap.back();
+        m_heap.pop_back();
+
+        if (timer.ticket != m_tickets[timer.cow])
+        {
+            continue;
+        }
+
+        m_tickets[timer.cow] += 1;
+        m_live[timer.cow] = false;
+        m_pending -= 1;
+        cows.push_back(timer.cow);
+    }
+}
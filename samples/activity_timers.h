@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Wake ups keyed on the simulation step, a binary min-heap of (step, cow). A cow
+// busy in an activity is only touched again on the step its timer fires, so the
+// herd pays per activity instead of per step.
+//
+// Every cow has at most one live timer. Scheduling again or cancelling bumps the
+// cow's ticket and the older entry is dropped when it reaches the top.
+class ActivityTimers
+{
+public:
+    ActivityTimers();
+
+    void Schedule(int cow, int step); // replaces the cow's pending timer
+    void Cancel(int cow);
+    void Clear();
+
+    // Appends the cows whose timer is due at step, earliest first
+    void PopDue(int step, std::vector<int> &cows);
+
+    int GetPendingCount() const { return m_pending; }
+
+private:
+    struct Timer
+    {
+        int step;
+        int cow;
+        uint32_t ticket;
+    };
+
+    static bool Later(const Timer &a, const Timer &b) { return a.step > b.step || (a.step == b.step && a.cow > b.cow); }
+
+    std::vector<Timer> m_heap;
+    std::vector<uint32_t> m_tickets; // per cow, entries with an older ticket are stale
+    std::vector<bool> m_live;        // per cow, a timer is pending
+    int m_pending;
+};
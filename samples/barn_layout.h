@@ -0,0 +1,31 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+// One cell of the canvas layout, in grid units. Kept apart from sample.h so the
+// planners and the benchmark build without the sample framework.
+struct SampleFunctionalArea
+{
+	int type;		 // cubicle, feeder, drinker, etc
+	int orientation; // horizontal or vertical
+	float x;		 // center
+	float y;		 // center
+};
+
+// Grid cells the area covers, the footprint MapMaker::LayoutToGrid blocks
+inline std::vector<std::pair<int, int>> AreaCells(const SampleFunctionalArea &area)
+{
+	int x = int(area.x);
+	int y = int(area.y);
+	std::vector<std::pair<int, int>> cells = {{x, y}};
+	if (area.orientation == 1)
+	{
+		cells.push_back({x, y + 1});
+	}
+	else if (area.orientation == 2)
+	{
+		cells.push_back({x + 1, y});
+	}
+	return cells;
+}
@@ -1,12 +1,16 @@
 // SPDX-FileCopyrightText: 2022 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "activity_timers.h"
 #include "draw.h"
 #include "functional_area.h"
 #include "cow.h"
+#include "herd.h"
 #include "sample.h"
 #include "settings.h"
 #include "mapmaker.h"
+#include "path_refiner.h"
+#include "plan_batch.h"
 #include "rrt.h"
 
 #include "box2d/box2d.h"
@@ -16,35 +20,6 @@
 #include <imgui.h>
 #include <iostream>
 
-// generate random integer
-int randomInt() { return rand(); }
-
-// generate random integer in a range [Min , Max)
-int randomInt(int a, int b)
-{
-	if (a > b)
-		return randomInt(b, a);
-	if (a == b)
-		return a;
-	return a + (rand() % (b - a));
-}
-
-// generate random fraction
-
-float randomFloat()
-{
-	return (float)(rand()) / (float)(RAND_MAX);
-}
-// generate random float in a range
-float randomFloat(int a, int b)
-{
-	if (a > b)
-		return randomFloat(b, a);
-	if (a == b)
-		return a;
-
-	return (float)randomInt(a, b) + randomFloat();
-}
 // std::vector<SampleFunctionalArea> Cow::cow_layout;
 RRT rrt;
 // Note: resetting the scene is non-deterministic because the world uses freelists
@@ -70,6 +45,18 @@ public:
 		CreateWorld();
 	}
 
+	~Barn() override
+	{
+		// The plan batch points into the cows and the map
+		WaitForPlans();
+	}
+
+	void WaitForPlans()
+	{
+		m_planBatch.Wait(&m_scheduler);
+		m_pathRefiner.Wait(&m_scheduler);
+	}
+
 	void CreateWorld()
 	{
 		b2World_SetGravity(m_worldId, b2Vec2_zero);
@@ -78,6 +65,9 @@ public:
 
 	void CreateLayout()
 	{
+		WaitForPlans();
+		m_pathRefiner.Clear();
+
 		// Destoy barns before create
 		for (int i = 0; i < e_maxRows * e_maxColumns; ++i)
 		{
@@ -96,18 +86,7 @@ public:
 		map.DestroyMaps();
 
 		// Destroy cows before create
-		for (int i = 0; i < e_maxRows * e_maxColumns; ++i)
-		{
-			if (B2_IS_NULL(m_cows[i].bodyId))
-			{
-				continue;
-			}
-
-			if (m_cows[i].m_isSpawned)
-			{
-				m_cows[i].Despawn();
-			}
-		}
+		m_herd.Clear();
 
 		// Cow::cow_layout = layout;
 
@@ -135,64 +114,127 @@ public:
 			index += 1;
 		}
 
-		// Create cow map
+		// Create cow map. The planners treat the cow as a disc of its half width plus a margin,
+		// the half length is left out since the cow walks along its path. The clearance stays
+		// under half a 24 unit cell, so a one cell aisle keeps a free strip down its middle.
+		static_assert(2 * (cow_weight + cow_corner_radius + cow_clearance_margin) < 24, "one cell aisles would close");
+		map.clearance = float(cow_weight + cow_corner_radius + cow_clearance_margin);
 		map.CreateCowMap();
 		cow_map = map.cow_map;
 		map.layout = layout;
 		map.corner_layout = corner_layout;
-		map.LayoutToGrid();
+		map.CreateGridMap();
+		map.CreateActivitySampler();
+		map.CreateFlowFields();
+		map.CreateChunkGraph();
+		map.CreateVisibilityGraph();
+		m_lastEdit = EditStats();
 
 
 		CreateCows();
 	}
 
-	void CreateCows()
+	// Small edits from the canvas keep the herd and patch the maps, only the cows
+	// whose route crosses the edit replan. A new grid size still needs Reset Scene.
+	void EditLayout()
 	{
-		srand(36);							  // random seed
-		int max_x = corner_layout.first * 24; // times 24 to fit the world
-		int max_y = corner_layout.second * 24;
+		WaitForPlans();
+		m_pathRefiner.Clear(); // the trees were grown around the old areas
+		b2Timer timer = b2CreateTimer();
 
-		// Destoy cows before create
-		for (int i = 0; i < e_maxRows * e_maxColumns; ++i)
+		int oldCount = int(map.layout.size());
+		LayoutEdit edit = map.EditLayout(layout);
+
+		// Kept areas move to their new index, removed ones go and new ones spawn
+		std::vector<FunctionalArea> areas(layout.size());
+		for (int i = 0; i < oldCount; ++i)
 		{
-			if (B2_IS_NULL(m_cows[i].bodyId))
+			if (edit.area_remap[i] >= 0)
 			{
-				continue;
+				areas[edit.area_remap[i]] = m_functinoal_areas[i];
+			}
+			else if (m_functinoal_areas[i].m_isSpawned)
+			{
+				m_functinoal_areas[i].Despawn();
 			}
+			m_functinoal_areas[i] = FunctionalArea();
+		}
+		for (int index : edit.added_areas)
+		{
+			const SampleFunctionalArea &func_are = layout[index];
+			areas[index].Spawn(m_worldId, func_are.x, func_are.y, func_are.type, func_are.orientation, 0.05f, 0.0f, 0.0f, index + 1, nullptr);
+		}
 
-			if (m_cows[i].m_isSpawned)
+		map.cow_aabbs.clear();
+		for (int i = 0; i < int(areas.size()); ++i)
+		{
+			m_functinoal_areas[i] = areas[i];
+			map.cow_aabbs.push_back(areas[i].aabb);
+		}
+		map.CreateCowMap();
+		m_lastEdit.made_corners = map.RepairVisibilityGraph();
+		cow_map = map.cow_map;
+
+		ObstacleIndex blocked;
+		blocked.Build(edit.blocked_boxes);
+		m_lastEdit.changed_cells = int(edit.changed_cells.size());
+		m_lastEdit.repaired_cells = edit.repaired_cells;
+		m_lastEdit.rebuilt_chunks = edit.rebuilt_chunks;
+		m_lastEdit.dropped_routes = m_routeCache.ApplyEdit(edit.area_remap, blocked);
+		m_lastEdit.replanned_cows = 0;
+		for (int i = 0; i < m_herd.GetCount(); ++i)
+		{
+			if (m_herd.GetCow(i).ApplyLayoutEdit(edit.area_remap, blocked))
 			{
-				m_cows[i].Despawn();
+				m_lastEdit.replanned_cows += 1;
 			}
 		}
+		m_lastEdit.milliseconds = b2GetMilliseconds(&timer);
+	}
+
+	void CreateCows()
+	{
+		RandomStream spawn_random(MixSeed(uint64_t(m_seed), uint64_t(-1))); // apart from the cow streams
+		int max_x = corner_layout.first * 24; // times 24 to fit the world
+		int max_y = corner_layout.second * 24;
+
+		// Destoy cows before create, the herd is sized to the new one
+		m_activityTimers.Clear();
+		m_herd.Create(number_of_cows);
 
 		// Create cows
 		int index = 0;
 		for (int i = 0; i < number_of_cows; i++)
 		{
 			b2Vec2 point;
-			int inflate = 42;
+			float inflate = 42.0f - map.clearance; // the index is already inflated
 			bool traped = true;
 			while (traped) // check cows start free
 			{
-				point = b2Vec2{rand() % max_x, rand() % max_y};
-				traped = false;
-				for (const auto &obstacle : map.cow_map)
-				{
-					if ((((obstacle.lowerBound.x - inflate) <= point.x) && (point.x <= (obstacle.upperBound.x + inflate))) &&
-						(((obstacle.lowerBound.y - inflate) <= point.y) && (point.y <= (obstacle.upperBound.y + inflate))))
-					{
-						traped = true;
-						break;
-					}
-				}
+				point = b2Vec2{float(spawn_random.NextInt(max_x)), float(spawn_random.NextInt(max_y))};
+				traped = map.obstacle_index.PointBlocked(point, inflate);
 			}
-			float cow_orientation = randomFloat(0, 360);
-			m_cows[index].Spawn(m_worldId, point.x, point.y, cow_orientation, 0.05f, 0.0f, 0.0f, index + 1, nullptr);
-			m_cows[index].cow_layout = layout;
-			m_cows[index].cow_map = map.cow_map;
-
-			m_cows[index].max_b_area = b2Vec2{max_x, max_x};
+			float cow_orientation = spawn_random.NextFloat(0.0f, 360.0f);
+			Cow &cow = m_herd.GetCow(index);
+			cow.SeedRandom(MixSeed(uint64_t(m_seed), uint64_t(index)));
+			cow.Spawn(m_worldId, point.x, point.y, cow_orientation, 0.05f, 0.0f, 0.0f, index + 1, nullptr);
+			cow.cow_layout = &map.layout;
+			cow.cow_map = &map.obstacle_index;
+			cow.cow_grid = &map.occupancy;
+			cow.cow_scratch = m_scratch; // the main thread is thread 0
+			cow.cow_batched = true;
+			cow.cow_batched_steering = true;
+			cow.cow_flow_fields = &map.flow_fields;
+			cow.cow_visibility = &map.visibility;
+			cow.cow_chunk_graph = &map.chunk_graph;
+			cow.cow_activities = &map.activities;
+			cow.cow_route_cache = m_useRouteCache ? &m_routeCache : nullptr;
+			cow.plan_budget = PlanBudgetFor(m_deterministic);
+			cow.engine = planner_engine(m_engine);
+
+			cow.max_b_area = b2Vec2{max_x, max_x};
+			cow.mode = rrt_mode(m_rrtMode);
+			cow.goal_bias = m_goalBias;
 			
 			index += 1;
 		}
@@ -200,14 +242,51 @@ public:
 
 	void ShowTools() override
 	{
-		float height = 80.0f;
+		float height = 340.0f;
 		ImGui::SetNextWindowPos(ImVec2(10.0f, g_camera.m_height - height - 50.0f), ImGuiCond_Once);
 		ImGui::SetNextWindowSize(ImVec2(220.0f, height));
 		ImGui::Begin("Barn", nullptr, ImGuiWindowFlags_NoResize);
+
+		bool changed_planner = false;
+		changed_planner = changed_planner || ImGui::Combo("Engine", &m_engine, planner_engine_names, engine_count);
+		changed_planner = changed_planner || ImGui::Combo("Planner", &m_rrtMode, rrt_mode_names, rrt_mode_count);
+		changed_planner = changed_planner || ImGui::SliderFloat("Goal bias", &m_goalBias, 0.0f, 1.0f, "%.2f");
+		changed_planner = changed_planner || ImGui::Checkbox("Route cache", &m_useRouteCache);
+		changed_planner = changed_planner || ImGui::Checkbox("Deterministic", &m_deterministic);
+		changed_planner = changed_planner || ImGui::Checkbox("Async planning", &m_asyncPlanning);
+		if (ImGui::Checkbox("Rest busy cows", &m_restBusyCows))
+		{
+			m_herd.SetRestBusyCows(m_restBusyCows);
+		}
+		if (m_deterministic)
+		{
+			ImGui::SliderInt("Refine iterations", &m_refineIterations, 0, 500);
+		}
+		else
+		{
+			ImGui::SliderFloat("Refine ms", &m_refineMilliseconds, 0.0f, 4.0f, "%.1f");
+		}
+		ImGui::SliderFloat("Time scale", &m_activityTimeScale, 1.0f, 600.0f, "%.0f");
+		if (changed_planner)
+		{
+			// Plans in flight read these settings
+			WaitForPlans();
+			for (int i = 0; i < m_herd.GetCount(); ++i)
+			{
+				Cow &cow = m_herd.GetCow(i);
+				cow.engine = planner_engine(m_engine);
+				cow.mode = rrt_mode(m_rrtMode);
+				cow.goal_bias = m_goalBias;
+				cow.cow_route_cache = m_useRouteCache ? &m_routeCache : nullptr;
+				cow.plan_budget = PlanBudgetFor(m_deterministic);
+			}
+		}
+
 		bool changed_scene = false;
 		bool changed_herd = false;
 		changed_scene = changed_scene || ImGui::Button("Reset Scene");
 		changed_herd = changed_herd || ImGui::Button("Reset Cows");
+		changed_herd = changed_herd || ImGui::SliderInt("Seed", &m_seed, 0, 1000);
 		if (changed_scene)
 		{
 			CreateLayout();
@@ -223,28 +302,259 @@ public:
 
 	void Step(Settings &settings) override
 	{
-		for (int i = 0; i < e_maxRows * e_maxColumns; ++i)
+		if (corner_layout == map.corner_layout && !map.SameLayout(layout))
+		{
+			EditLayout();
+		}
+
+		// Simulated time only moves when the world steps, see Sample::Step
+		if (settings.hertz > 0.0f && (settings.pause == false || settings.singleStep))
+		{
+			m_simStep += 1;
+		}
+
+		// Cows whose activity is over head for their next target before the routines run
+		m_wokenCows.clear();
+		m_activityTimers.PopDue(m_simStep, m_wokenCows);
+		for (int i : m_wokenCows)
 		{
-			if (B2_IS_NULL(m_cows[i].bodyId))
+			m_herd.Activate(i);
+			m_herd.GetCow(i).EndActivity();
+		}
+
+		// Busy cows are off the active list and wait for their timer
+		m_herd.FetchPoses();
+		for (int slot = 0; slot < m_herd.GetActiveCount();)
+		{
+			int i = m_herd.GetActive(slot);
+			Cow &cow = m_herd.GetCow(i);
+			cow.Routine(m_herd.GetPose(i));
+
+			if (cow.refine_wanted)
 			{
+				cow.refine_wanted = false;
+				if (RefineSlice().max_iterations > 0)
+				{
+					m_pathRefiner.Track(&cow);
+				}
+			}
+			if (cow.activity_started)
+			{
+				// The last active cow moves into this slot and runs next
+				cow.activity_started = false;
+				m_activityTimers.Schedule(i, m_simStep + ActivitySteps(cow.ActivitySeconds(), settings.hertz));
+				m_herd.Deactivate(i);
 				continue;
 			}
+			slot += 1;
+		}
+		m_herd.Steer();
+
+		// One batch for every cow that asked for a route. Async lets it land on a later
+		// step while the physics runs, otherwise it lands before this step ends.
+		if (Landed(m_planBatch.IsInFlight(), m_planLanding))
+		{
+			if (m_deterministic)
+			{
+				m_planBatch.Wait(&m_scheduler);
+			}
+			if (m_planBatch.Harvest() && m_planBatch.Submit(&m_scheduler, m_herd, m_scratch))
+			{
+				m_planLanding = m_simStep + m_landingSteps;
+				if (m_asyncPlanning == false)
+				{
+					m_planBatch.Wait(&m_scheduler);
+				}
+			}
+		}
 
-			if (m_cows[i].m_isSpawned)
+		// RRT* paths get one slice per step, on the step when async is off
+		if (Landed(m_pathRefiner.IsInFlight(), m_refineLanding))
+		{
+			if (m_deterministic)
+			{
+				m_pathRefiner.Wait(&m_scheduler);
+			}
+			if (m_pathRefiner.Harvest())
+			{
+				m_pathRefiner.Submit(&m_scheduler, RefineSlice());
+				m_refineLanding = m_simStep + m_landingSteps;
+				if (m_asyncPlanning == false)
+				{
+					m_pathRefiner.Wait(&m_scheduler);
+				}
+			}
+		}
+
+		const PlanStats &plan_stats = m_herd.plan_stats;
+		const ModeStats *mode_stats = plan_stats.modes;
+		const EngineStats *engine_stats = plan_stats.engines;
+		g_draw.DrawString(5, m_textLine, "cows waiting for a plan = %d, batch = %d%s", m_herd.CountState(cow_planning),
+						  m_planBatch.GetCount(),
+						  m_planBatch.IsInFlight() ? " (planning)" : "");
+		m_textLine += m_textIncrement;
+
+		g_draw.DrawString(5, m_textLine, "cows steered = %d, in an activity = %d, timers = %d, barn time = %.0f s",
+						  m_herd.GetSteeredCount(), m_herd.GetCount() - m_herd.GetActiveCount(),
+						  m_activityTimers.GetPendingCount(),
+						  settings.hertz > 0.0f ? m_simStep * m_activityTimeScale / settings.hertz : 0.0f);
+		m_textLine += m_textIncrement;
+
+		// Resting cows sleep, the awake set is the moving cows and the resting cows they push
+		b2Counters counters = b2World_GetCounters(m_worldId);
+		g_draw.DrawString(5, m_textLine, "awake bodies/contacts = %d/%d of %d/%d", counters.awakeBodyCount,
+						  counters.awakeContactCount, counters.bodyCount, counters.contactCount);
+		m_textLine += m_textIncrement;
+
+		g_draw.DrawString(5, m_textLine, "rrt nearest queries/visited per query = %lld/%.1f", plan_stats.nearest.queries,
+						  plan_stats.nearest.VisitedPerQuery());
+		m_textLine += m_textIncrement;
+
+		for (int mode = 0; mode < rrt_mode_count; ++mode)
+		{
+			if (mode_stats[mode].plans == 0)
+			{
+				continue;
+			}
+
+			g_draw.DrawString(5, m_textLine,
+							  "rrt %s plans/found/iterations to solution = %lld/%lld/%.1f, vertices raw/smooth = %.1f/%.1f",
+							  rrt_mode_names[mode], mode_stats[mode].plans, mode_stats[mode].found,
+							  mode_stats[mode].IterationsPerSolution(), mode_stats[mode].RawVerticesPerPath(),
+							  mode_stats[mode].SmoothVerticesPerPath());
+			m_textLine += m_textIncrement;
+		}
+
+		for (int engine = 0; engine < engine_count; ++engine)
+		{
+			if (engine_stats[engine].plans == 0)
 			{
-				m_cows[i].Routine();
+				continue;
 			}
+
+			g_draw.DrawString(5, m_textLine, "%s plans/found = %lld/%lld, ms/expanded per plan = %.3f/%.1f, path length = %.1f",
+							  planner_engine_names[engine], engine_stats[engine].plans, engine_stats[engine].found,
+							  engine_stats[engine].MillisecondsPerPlan(), engine_stats[engine].ExpandedPerPlan(),
+							  engine_stats[engine].LengthPerPath());
+			m_textLine += m_textIncrement;
+		}
+
+		const RefineStats &refine_stats = m_pathRefiner.GetStats();
+		if (refine_stats.slices > 0)
+		{
+			g_draw.DrawString(5, m_textLine, "rrt* refining = %d, paths shortened = %lld, length saved = %.0f",
+							  m_pathRefiner.GetBusyCount(), refine_stats.improvements, refine_stats.length_saved);
+			m_textLine += m_textIncrement;
+		}
+
+		if (m_lastEdit.changed_cells > 0)
+		{
+			g_draw.DrawString(5, m_textLine, "last edit cells/repaired = %d/%d, chunks = %d/%d, corners = %d/%d, routes dropped = %d, cows replanned = %d, %.2f ms",
+							  m_lastEdit.changed_cells, m_lastEdit.repaired_cells, m_lastEdit.rebuilt_chunks,
+							  map.chunk_graph.GetChunkCount(), m_lastEdit.made_corners, map.visibility.GetNodeCount(), m_lastEdit.dropped_routes,
+							  m_lastEdit.replanned_cows, m_lastEdit.milliseconds);
+			m_textLine += m_textIncrement;
+		}
+
+		if (m_useRouteCache)
+		{
+			const RouteCacheStats &cache_stats = m_routeCache.GetStats();
+			g_draw.DrawString(5, m_textLine, "route cache hits/lookups = %lld/%lld (%.0f%%), routes = %d, invalidations = %lld",
+							  cache_stats.hits, cache_stats.lookups, 100.0f * cache_stats.HitRate(), m_routeCache.GetCount(),
+							  cache_stats.invalidations);
+			m_textLine += m_textIncrement;
 		}
+
 		Sample::Step(settings);
 	}
 
+	// Steps an activity of seconds takes, at least one so the cow leaves on a later step
+	int ActivitySteps(float seconds, float hertz) const
+	{
+		if (hertz <= 0.0f)
+		{
+			return 1;
+		}
+		return b2MaxInt(int(ceilf(seconds * hertz / m_activityTimeScale)), 1);
+	}
+
+	// Async work lands on the first step it is done, which depends on the machine. Deterministic
+	// runs land it m_landingSteps after it was submitted instead, waiting only if it still runs.
+	bool Landed(bool in_flight, int landing) const
+	{
+		return in_flight == false || m_deterministic == false || m_simStep >= landing;
+	}
+
+	// Plans stop on iterations only when deterministic, otherwise also on the clock
+	static PlanBudget PlanBudgetFor(bool deterministic)
+	{
+		PlanBudget budget;
+		if (deterministic)
+		{
+			budget.max_milliseconds = 0.0f;
+		}
+		return budget;
+	}
+
+	// Slice of one step for every refining path, empty when refining is off
+	PlanBudget RefineSlice() const
+	{
+		PlanBudget slice;
+		if (m_deterministic)
+		{
+			slice.max_iterations = m_refineIterations;
+			slice.max_milliseconds = 0.0f;
+		}
+		else
+		{
+			slice.max_iterations = m_refineMilliseconds > 0.0f ? slice.max_iterations : 0;
+			slice.max_milliseconds = m_refineMilliseconds;
+		}
+		return slice;
+	}
+
 	static Sample *Create(Settings &settings)
 	{
 		return new Barn(settings);
 	}
 
+	int m_seed = 36; // scenario seed, every cow and plan stream derives from it
+	bool m_deterministic = false; // no clock in the plan budgets and fixed landing steps, a seed replays the same barn
+	int m_engine = engine_rrt;
+	int m_rrtMode = rrt_uniform;
+	float m_goalBias = 0.1f;
+
+	PlannerScratch m_scratch[maxThreads]; // planner memory for each scheduler thread
+	PlanBatch m_planBatch;
+	PathRefiner m_pathRefiner;
+	float m_refineMilliseconds = 1.0f; // slice of every step each refining path gets, 0 stops refining
+	int m_refineIterations = 100;      // the same slice when deterministic
+	bool m_asyncPlanning = true;
+	int m_landingSteps = 4; // steps from submit to harvest for async work when deterministic
+	int m_planLanding = 0;
+	int m_refineLanding = 0;
+	RouteCache m_routeCache;   // keyed on the grid version, so a new layout invalidates it
+	bool m_useRouteCache = true;
+	bool m_restBusyCows = true; // see Herd::SetRestBusyCows
+	ActivityTimers m_activityTimers; // ends the activities, keyed on m_simStep
+	std::vector<int> m_wokenCows;
+	int m_simStep = 0;
+	float m_activityTimeScale = 60.0f; // barn seconds per simulated second, activities last tens of minutes
+
+	struct EditStats
+	{
+		int changed_cells = 0;
+		int repaired_cells = 0; // flow field cells redone, a full rebuild does every cell of every field
+		int rebuilt_chunks = 0; // chunk graph chunks redone, out of GetChunkCount
+		int made_corners = 0;   // visibility graph corners tested against every other one
+		int dropped_routes = 0;
+		int replanned_cows = 0;
+		float milliseconds = 0.0f;
+	};
+	EditStats m_lastEdit;
+
 	FunctionalArea m_functinoal_areas[e_maxRows * e_maxColumns];
-	Cow m_cows[e_maxRows * e_maxColumns];
+	Herd m_herd;
 	MapMaker map;
 	// MapMaker map(layout);
 	// int m_columnCount;
@@ -0,0 +1,305 @@
+#include "chunk_graph.h"
+#include "planner.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <functional>
+
+namespace
+{
+// Free runs along a border at least this long get an entrance at both ends instead of one in the middle
+const int k_wideEntrance = 6;
+} // namespace
+
+ChunkGraph::ChunkGraph()
+{
+    m_grid = nullptr;
+    m_chunkSize = 1;
+    m_chunksX = 0;
+    m_chunksY = 0;
+}
+
+void ChunkGraph::Build(const OccupancyGrid &grid, int chunk_size)
+{
+    m_grid = &grid;
+    m_chunkSize = b2MaxInt(chunk_size, 1);
+    m_chunksX = (grid.GetWidth() + m_chunkSize - 1) / m_chunkSize;
+    m_chunksY = (grid.GetHeight() + m_chunkSize - 1) / m_chunkSize;
+    m_chunks.assign(m_chunksX * m_chunksY, Chunk());
+    m_slots.assign(grid.GetCellCount(), -1);
+
+    for (int chunk = 0; chunk < int(m_chunks.size()); ++chunk)
+    {
+        RebuildChunk(chunk);
+    }
+}
+
+void ChunkGraph::Clear()
+{
+    m_grid = nullptr;
+    m_chunksX = 0;
+    m_chunksY = 0;
+    m_chunks.clear();
+    m_slots.clear();
+}
+
+int ChunkGraph::RepairCells(const std::vector<std::pair<int, int>> &changed_cells)
+{
+    std::vector<int> dirty;
+    for (const std::pair<int, int> &cell : changed_cells)
+    {
+        int x = cell.first;
+        int y = cell.second;
+        int chunk = (y / m_chunkSize) * m_chunksX + x / m_chunkSize;
+        dirty.push_back(chunk);
+
+        // A cell on a border also moves the entrances of the chunk across it
+        if (x % m_chunkSize == 0 && x > 0)
+        {
+            dirty.push_back(chunk - 1);
+        }
+        if (x % m_chunkSize == m_chunkSize - 1 && x + 1 < m_grid->GetWidth())
+        {
+            dirty.push_back(chunk + 1);
+        }
+        if (y % m_chunkSize == 0 && y > 0)
+        {
+            dirty.push_back(chunk - m_chunksX);
+        }
+        if (y % m_chunkSize == m_chunkSize - 1 && y + 1 < m_grid->GetHeight())
+        {
+            dirty.push_back(chunk + m_chunksX);
+        }
+    }
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    for (int chunk : dirty)
+    {
+        RebuildChunk(chunk);
+    }
+    return int(dirty.size());
+}
+
+void ChunkGraph::RebuildChunk(int chunk)
+{
+    Chunk &c = m_chunks[chunk];
+    for (int cell : c.cells)
+    {
+        m_slots[cell] = -1;
+    }
+    c.cells.clear();
+    c.links.clear();
+
+    int x0 = (chunk % m_chunksX) * m_chunkSize;
+    int y0 = (chunk / m_chunksX) * m_chunkSize;
+    int x1 = b2MinInt(x0 + m_chunkSize, m_grid->GetWidth());
+    int y1 = b2MinInt(y0 + m_chunkSize, m_grid->GetHeight());
+
+    // Both chunks of a border walk it in the same direction, so they agree on its entrances
+    if (x0 > 0)
+    {
+        AddBorder(chunk, x0, y0, 0, 1, y1 - y0, -1, 0);
+    }
+    if (x1 < m_grid->GetWidth())
+    {
+        AddBorder(chunk, x1 - 1, y0, 0, 1, y1 - y0, 1, 0);
+    }
+    if (y0 > 0)
+    {
+        AddBorder(chunk, x0, y0, 1, 0, x1 - x0, 0, -1);
+    }
+    if (y1 < m_grid->GetHeight())
+    {
+        AddBorder(chunk, x0, y1 - 1, 1, 0, x1 - x0, 0, 1);
+    }
+
+    int count = int(c.cells.size());
+    c.costs.assign(count * count, FLT_MAX);
+    for (int i = 0; i < count; ++i)
+    {
+        SearchChunk(c.cells[i], -1, m_search);
+        for (int j = 0; j < count; ++j)
+        {
+            c.costs[i * count + j] = m_search.costs[LocalCell(c.cells[j])];
+        }
+    }
+}
+
+void ChunkGraph::AddBorder(int chunk, int x, int y, int dx, int dy, int length, int out_x, int out_y)
+{
+    int width = m_grid->GetWidth();
+    int runStart = -1;
+    for (int i = 0; i <= length; ++i)
+    {
+        int cx = x + i * dx;
+        int cy = y + i * dy;
+        bool open = i < length && !m_grid->IsBlocked(cx, cy) && !m_grid->IsBlocked(cx + out_x, cy + out_y);
+        if (open && runStart < 0)
+        {
+            runStart = i;
+        }
+        if (open || runStart < 0)
+        {
+            continue;
+        }
+
+        // Run [runStart, i) ended
+        int picks[2] = {(runStart + i - 1) / 2, -1};
+        if (i - runStart >= k_wideEntrance)
+        {
+            picks[0] = runStart;
+            picks[1] = i - 1;
+        }
+        for (int pick : picks)
+        {
+            if (pick >= 0)
+            {
+                int px = x + pick * dx;
+                int py = y + pick * dy;
+                AddEntrance(chunk, py * width + px, (py + out_y) * width + px + out_x);
+            }
+        }
+        runStart = -1;
+    }
+}
+
+void ChunkGraph::AddEntrance(int chunk, int cell, int partner)
+{
+    Chunk &c = m_chunks[chunk];
+    if (m_slots[cell] < 0)
+    {
+        m_slots[cell] = int(c.cells.size());
+        c.cells.push_back(cell);
+    }
+    c.links.push_back({m_slots[cell], partner});
+}
+
+void ChunkGraph::SearchChunk(int cell, int target, ChunkSearch &search) const
+{
+    int size = m_chunkSize * m_chunkSize;
+    search.costs.assign(size, FLT_MAX);
+    search.parents.assign(size, -1);
+    search.open.clear();
+
+    int source = LocalCell(cell);
+    search.costs[source] = 0.0f;
+    search.open.push_back({0.0f, source});
+    RunSearch(ChunkOf(cell), target >= 0 ? LocalCell(target) : -1, search);
+}
+
+void ChunkGraph::SearchChunk(const std::vector<int> &cells, ChunkSearch &search) const
+{
+    int size = m_chunkSize * m_chunkSize;
+    search.costs.assign(size, FLT_MAX);
+    search.parents.assign(size, -1);
+    search.open.clear();
+    if (cells.empty())
+    {
+        return;
+    }
+
+    for (int cell : cells)
+    {
+        assert(ChunkOf(cell) == ChunkOf(cells[0]));
+        int source = LocalCell(cell);
+        search.costs[source] = 0.0f;
+        search.open.push_back({0.0f, source});
+    }
+    RunSearch(ChunkOf(cells[0]), -1, search);
+}
+
+void ChunkGraph::RunSearch(int chunk, int target_local, ChunkSearch &search) const
+{
+    int x0 = (chunk % m_chunksX) * m_chunkSize;
+    int y0 = (chunk / m_chunksX) * m_chunkSize;
+    int x1 = b2MinInt(x0 + m_chunkSize, m_grid->GetWidth());
+    int y1 = b2MinInt(y0 + m_chunkSize, m_grid->GetHeight());
+
+    // The sources all cost zero, a heap of them is already ordered
+    std::greater<std::pair<float, int>> later;
+    while (!search.open.empty())
+    {
+        std::pop_heap(search.open.begin(), search.open.end(), later);
+        std::pair<float, int> node = search.open.back();
+        search.open.pop_back();
+
+        int local = node.second;
+        if (node.first > search.costs[local])
+        {
+            continue;
+        }
+        if (local == target_local)
+        {
+            return;
+        }
+
+        int x = x0 + local % m_chunkSize;
+        int y = y0 + local / m_chunkSize;
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                int nx = x + dx;
+                int ny = y + dy;
+                if ((dx == 0 && dy == 0) || nx < x0 || nx >= x1 || ny < y0 || ny >= y1 || m_grid->IsBlocked(nx, ny))
+                {
+                    continue;
+                }
+
+                // Same moves as GridPlanner, diagonals may not cut corners
+                float step = 1.0f;
+                if (dx != 0 && dy != 0)
+                {
+                    if (m_grid->IsBlocked(nx, y) || m_grid->IsBlocked(x, ny))
+                    {
+                        continue;
+                    }
+                    step = k_diagonalCost;
+                }
+
+                int next = (ny - y0) * m_chunkSize + nx - x0;
+                float cost = node.first + step;
+                if (cost < search.costs[next])
+                {
+                    search.costs[next] = cost;
+                    search.parents[next] = local;
+                    search.open.push_back({cost, next});
+                    std::push_heap(search.open.begin(), search.open.end(), later);
+                }
+            }
+        }
+    }
+}
+
+int ChunkGraph::ChunkOf(int cell) const
+{
+    int width = m_grid->GetWidth();
+    return (cell / width / m_chunkSize) * m_chunksX + (cell % width) / m_chunkSize;
+}
+
+int ChunkGraph::LocalCell(int cell) const
+{
+    int width = m_grid->GetWidth();
+    return ((cell / width) % m_chunkSize) * m_chunkSize + (cell % width) % m_chunkSize;
+}
+
+int ChunkGraph::GridCell(int chunk, int local) const
+{
+    int x = (chunk % m_chunksX) * m_chunkSize + local % m_chunkSize;
+    int y = (chunk / m_chunksX) * m_chunkSize + local / m_chunkSize;
+    return y * m_grid->GetWidth() + x;
+}
+
+int ChunkGraph::GetNodeCount() const
+{
+    int count = 0;
+    for (const Chunk &chunk : m_chunks)
+    {
+        count += int(chunk.cells.size());
+    }
+    return count;
+}
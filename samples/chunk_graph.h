@@ -0,0 +1,78 @@
+#pragma once
+
+#include "occupancy_grid.h"
+
+#include <utility>
+#include <vector>
+
+// Dijkstra scratch for one chunk, indexed by the cell inside the chunk
+struct ChunkSearch
+{
+    std::vector<float> costs;  // in cells, FLT_MAX where the search did not reach
+    std::vector<int> parents;  // chunk cell the cost came from, -1 at the source
+    std::vector<std::pair<float, int>> open;
+};
+
+// Abstract graph for hierarchical planning (HPA*). The occupancy grid is cut into
+// square chunks, every free run along a border between two chunks gets one or two
+// entrances, and the entrances of a chunk are joined by their shortest distance
+// inside it. A long route then searches a few nodes per chunk instead of every cell.
+//
+// Nodes are identified by their grid cell. Each chunk only depends on its own cells
+// and the cells across its borders, so an edited cell rebuilds its chunk, plus the
+// neighbour when the cell lies on their shared border.
+class ChunkGraph
+{
+public:
+    struct Link
+    {
+        int node;    // index into Chunk::cells
+        int partner; // entrance cell across the border, one step away
+    };
+
+    struct Chunk
+    {
+        std::vector<int> cells;   // entrance cells inside the chunk
+        std::vector<Link> links;
+        std::vector<float> costs; // cells.size() squared, FLT_MAX when the chunk splits two entrances
+    };
+
+    ChunkGraph();
+
+    void Build(const OccupancyGrid &grid, int chunk_size); // grid must outlive the graph
+    void Clear();
+
+    // Call after the cells changed in the grid, returns the number of chunks rebuilt
+    int RepairCells(const std::vector<std::pair<int, int>> &changed_cells);
+
+    // Costs from cell to the cells of its chunk. With target >= 0 the search stops once
+    // that grid cell is settled, enough to walk its parents back to cell.
+    void SearchChunk(int cell, int target, ChunkSearch &search) const;
+
+    // Costs from the closest of several cells of one chunk, the parents lead back to it
+    void SearchChunk(const std::vector<int> &cells, ChunkSearch &search) const;
+
+    int ChunkOf(int cell) const;
+    int LocalCell(int cell) const; // index of the cell inside its chunk
+    int GridCell(int chunk, int local) const;
+    int GetSlot(int cell) const { return m_slots[cell]; } // index into its chunk's cells, -1 if not a node
+    const Chunk &GetChunk(int chunk) const { return m_chunks[chunk]; }
+    const OccupancyGrid *GetGrid() const { return m_grid; }
+    int GetChunkSize() const { return m_chunkSize; }
+    int GetChunkCount() const { return int(m_chunks.size()); }
+    int GetNodeCount() const;
+
+private:
+    void RebuildChunk(int chunk);
+    void RunSearch(int chunk, int target_local, ChunkSearch &search) const; // after the sources are seeded
+    void AddBorder(int chunk, int x, int y, int dx, int dy, int length, int out_x, int out_y);
+    void AddEntrance(int chunk, int cell, int partner);
+
+    const OccupancyGrid *m_grid;
+    int m_chunkSize;
+    int m_chunksX;
+    int m_chunksY;
+    std::vector<Chunk> m_chunks;
+    std::vector<int> m_slots; // per grid cell
+    ChunkSearch m_search;     // build scratch
+};
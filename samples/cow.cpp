@@ -1,31 +1,22 @@
 #include "cow.h"
-#include "sample.h"
+#include "herd.h"
 #include "rrt.h"
 
 #include "box2d/box2d.h"
 #include "box2d/math_functions.h"
 
 #include <assert.h>
+#include <float.h>
 #include <cmath>
 #include <iostream>
 #include <algorithm>
-#include <random>
 #include <vector>
 #include <map>
 #include <boost/algorithm/clamp.hpp>
 
-//Random numbers
-std::vector<std::vector<float>> TRANSITION_MATRIX = {
-    {0.33f, 0.29f, 0.04f, 0.45f, 0.94f}, // Cubicle
-    {0.16f, 0.59f, 0.28f, 0.01f, 0.68f}, // Milker
-    {0.51f, 0.48f, 0.33f, 0.69f, 0.17f}, // Feeder
-    {0.29f, 0.28f, 0.11f, 0.98f, 0.79f}, // Concentrate
-    {0.73f, 0.50f, 0.73f, 0.50f, 0.73f}, // Drinker
-};
-
-int ACTIVITY_FACTOR = 60;
+int ACTIVITY_FACTOR = 60; // seconds per minute
 
-// Random numbers
+// Simulated seconds per activity, random numbers in minutes
 std::vector<int> ACTIVITY_DURATION = {
     int(88 * ACTIVITY_FACTOR),
     int(61 * ACTIVITY_FACTOR),
@@ -36,11 +27,30 @@ std::vector<int> ACTIVITY_DURATION = {
 
 Cow::Cow()
 {
-    bodyId = b2_nullBodyId;
     m_isSpawned = false;
-    cow_var.state = cow_starting;
-    cow_var.waypoint_index = 0;
-    cow_var.current_activity = rand() % 4;
+    cow_herd = nullptr;
+    cow_index = -1;
+    cow_layout = nullptr;
+    cow_map = nullptr;
+    cow_grid = nullptr;
+    cow_scratch = nullptr;
+    cow_flow_fields = nullptr;
+    cow_visibility = nullptr;
+    cow_chunk_graph = nullptr;
+    cow_activities = nullptr;
+    cow_route_cache = nullptr;
+    cow_batched = false;
+    cow_batched_steering = false;
+    refine_wanted = false;
+    activity_started = false;
+    cow_var.current_activity = 0;
+    cow_seed = 0;
+    plan_count = 0;
+    cow_var.partial_path = false;
+    cow_var.failed_plans = 0;
+    cow_var.partial_gap = FLT_MAX;
+    cow_var.current_area_index = 0;
+    cow_var.following_field = false;
     // cow_var.speed = 0.0f;
     // cow_var.steering_angle = 0.0f;
 }
@@ -53,6 +63,7 @@ void Cow::Spawn(b2WorldId worldId, float x, float y, float orientation, float sc
 
 {
     assert(m_isSpawned == false);
+    assert(cow_herd != nullptr);
 
     b2BodyDef bodyDef = b2DefaultBodyDef();
     bodyDef.type = b2_dynamicBody;
@@ -60,22 +71,26 @@ void Cow::Spawn(b2WorldId worldId, float x, float y, float orientation, float sc
     bodyDef.userData = userData;
     bodyDef.position = {x, y};
     // bodyDef.angle = orientation;
-    bodyId = b2CreateBody(worldId, &bodyDef);
+    b2BodyId bodyId = b2CreateBody(worldId, &bodyDef);
 
     b2ShapeDef shapeDef = b2DefaultShapeDef();
-    shapeDef.density = 1 + rand() % 100; // 1.0f;
+    shapeDef.density = 1 + cow_random.NextInt(100); // 1.0f;
     shapeDef.friction = 0.1f;
     shapeDef.customColor = cow_color;
 
     // shapeDef.filter.groupIndex = -groupIndex;
     // shapeDef.filter.maskBits = 1;
 
-    b2Polygon box = b2MakeRoundedBox(cow_height, cow_weight, 7.0f);
+    b2Polygon box = b2MakeRoundedBox(cow_height, cow_weight, cow_corner_radius);
     b2CreatePolygonShape(bodyId, &shapeDef, &box);
 
     // b2Body_ApplyMassFromShapes(bodyId);
     // b2Body_ApplyForceToCenter(bodyId, {10000.0f, 0.0f}, true);
 
+    cow_herd->body_ids[cow_index] = bodyId;
+    State() = cow_starting;
+    WaypointIndex() = 0;
+    IdleSteps() = 0;
     m_isSpawned = true;
 }
 
@@ -83,17 +98,32 @@ void Cow::Despawn()
 {
     assert(m_isSpawned == true);
 
+    b2BodyId &bodyId = cow_herd->body_ids[cow_index];
     if (B2_IS_NON_NULL(bodyId))
     {
         b2DestroyBody(bodyId);
         bodyId = b2_nullBodyId;
 
-        cow_layout.clear();
-        cow_map.clear();
+        cow_layout = nullptr;
+        cow_map = nullptr;
+        cow_grid = nullptr;
+        cow_scratch = nullptr;
+        cow_flow_fields = nullptr;
+        cow_visibility = nullptr;
+        cow_chunk_graph = nullptr;
+        cow_activities = nullptr;
+        cow_route_cache = nullptr;
+        cow_batched = false;
+        cow_batched_steering = false;
+        refine_wanted = false;
+        activity_started = false;
         max_b_area = b2Vec2{0.0f, 0.0f};
         cow_path.clear();
-        nodes.clear();
         cow_var = {};
+        State() = cow_starting;
+        WaypointIndex() = 0;
+        Target() = b2Vec2_zero;
+        IdleSteps() = 0;
     }
 
     m_isSpawned = false;
@@ -106,8 +136,8 @@ void Cow::Cow_move_model(cow_pose cow_pose)
     float dx = cow_var.speed * cosf(cow_pose.angle);
     float dy = cow_var.speed * sinf(cow_pose.angle);
     float dt = (cow_var.speed / float(cow_leg_base)) * tanf(cow_var.steering_angle);
-    b2Body_SetLinearVelocity(bodyId, {dx, dy});
-    b2Body_SetAngularVelocity(bodyId, dt);
+    b2Body_SetLinearVelocity(BodyId(), {dx, dy});
+    b2Body_SetAngularVelocity(BodyId(), dt);
 }
 
 void Cow::Cow_control_to_point(cow_pose cow_pose)
@@ -119,159 +149,500 @@ void Cow::Cow_control_to_point(cow_pose cow_pose)
     cow_var.steering_angle = b2ClampFloat(heading_error, -cow_max_steering_angle, cow_max_steering_angle);
 }
 
-int select_weighted_random(const std::vector<float> &weights)
+int Cow::Get_target()
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::discrete_distribution<> dist(weights.begin(), weights.end());
-    return dist(gen);
+    // One alias table lookup, only activities the layout has an area for can come up
+    int next_activity = cow_activities->NextActivity(cow_var.current_activity, cow_random);
+    if (next_activity < 0)
+    {
+        return -1;
+    }
+
+    cow_var.current_activity = next_activity;
+    cow_var.current_area_index = cow_activities->PickArea(next_activity, cow_random); // the flow fields use the same index
+    cow_var.current_functional_area = (*cow_layout)[cow_var.current_area_index];
+
+    // times 24 + 12 to match world
+    b2Vec2 goal;
+    goal = b2Vec2{cow_var.current_functional_area.x, cow_var.current_functional_area.y} * 24;
+    goal.x += 12;
+    goal.y += 12;
+
+    Target() = goal;
+    return cow_var.current_area_index;
 }
 
-int next_manner_from_TM(const int &temp_manner, const std::vector<int> &available_manners)
+void Cow::RunPlanner(PlannerScratch &scratch, PlanOutput &output) const
 {
-    int index = select_weighted_random(TRANSITION_MATRIX[temp_manner]);
-    // int next_manner = ACTIVITY_NAMES[index];
-    // std::cout << "index: " << index << std::endl;
+    b2Timer timer = b2CreateTimer();
+    PlanResult &result = output.result;
+    result = PlanResult();
+    if (output.engine == engine_rrt)
+    {
+        // The cow only carries the settings and the seeded stream, the tree grows in the scratch
+        RRT &rrt = scratch.rrt;
+        rrt.mode = mode;
+        rrt.goal_bias = goal_bias;
+        rrt.use_node_grid = use_node_grid;
+        rrt.brute_force_limit = brute_force_limit;
+        rrt.smooth_paths = smooth_paths;
+        rrt.random = random;
+        for (ModeStats &stats : rrt.mode_stats)
+        {
+            stats = ModeStats();
+        }
+        rrt.nearest_stats = NearestStats();
+
+        result = rrt.FindPath(cow_var.start, Target(), cow_map, max_b_area, 24.0f, 56.0f, plan_budget);
 
-    // Check if the selected manner is in the available manners
-    if (std::find(available_manners.begin(), available_manners.end(), index) == available_manners.end())
+        for (int i = 0; i < rrt_mode_count; ++i)
+        {
+            output.mode_stats[i] = rrt.mode_stats[i];
+        }
+        output.nearest_stats = rrt.nearest_stats;
+    }
+    else if (output.engine == engine_flow)
     {
-        // If not found, recursively call the function
-        return next_manner_from_TM(temp_manner, available_manners);
+        // Only checks the field reaches the cow, the path stays empty and the field is followed every step
+        b2Vec2 waypoint;
+        if (cow_flow_fields->NextWaypoint(cow_var.current_area_index, cow_var.start, &waypoint) != flow_lost)
+        {
+            result.status = plan_found;
+        }
     }
-    // std::cout << "index: " << index << std::endl;
+    else
+    {
+        // Any free cell beside the area ends the plan, the cells its flow field is seeded from,
+        // so one walled in side does not hide the others
+        const OccupancyGrid &grid = output.engine == engine_hierarchical ? *cow_chunk_graph->GetGrid() : *cow_grid;
+        grid.FindSideCells(AreaCells(cow_var.current_functional_area), scratch.goal_cells);
+
+        if (output.engine == engine_visibility)
+        {
+            scratch.goal_points.clear();
+            for (const std::pair<int, int> &cell : scratch.goal_cells)
+            {
+                scratch.goal_points.push_back(grid.CellCenter(cell.first, cell.second));
+            }
+            result = scratch.visibility.FindPath(cow_var.start, scratch.goal_points, *cow_visibility, plan_budget);
+        }
+        else if (output.engine == engine_hierarchical)
+        {
+            result = scratch.hierarchical.FindPath(cow_var.start, scratch.goal_cells, *cow_chunk_graph, plan_budget);
+        }
+        else
+        {
+            result = scratch.grid.FindPath(cow_var.start, scratch.goal_cells, *cow_grid, output.engine == engine_jps,
+                                           plan_budget);
+        }
+    }
+
+    output.milliseconds = b2GetMilliseconds(&timer);
+}
+
+bool Cow::IsCacheable(planner_engine used) const
+{
+    // Flow fields need no route
+    return cow_route_cache != nullptr && cow_grid != nullptr && used != engine_flow;
+}
 
-    return index;
+int Cow::CacheVariant(planner_engine used) const
+{
+    // RRT modes find different routes, the other engines have one way to plan
+    return used == engine_rrt ? int(mode) : 0;
+}
+
+int Cow::StartCell() const
+{
+    int x, y;
+    cow_grid->WorldToCell(cow_var.start, &x, &y);
+    return y * cow_grid->GetWidth() + x;
 }
 
-std::vector<int> Cow::get_availabe_activities()
+void Cow::SeedRandom(uint64_t seed)
 {
-    std::vector<int> availab_act;
-    for (auto functional_area : cow_layout)
+    cow_seed = seed;
+    plan_count = 0;
+    cow_random.Seed(seed);
+    cow_var.current_activity = cow_random.NextInt(4);
+}
+
+void Cow::PlanToTarget()
+{
+    cow_var.start = b2Body_GetPosition(BodyId());
+
+    // Every request gets its own stream, so the tree does not depend on the thread or the cache
+    random.Seed(MixSeed(cow_seed, plan_count));
+    plan_count += 1;
+
+    // Grid engines fall back to RRT until the barn hands out a grid
+    planner_engine used = engine;
+    if ((used == engine_astar || used == engine_jps) && cow_grid == nullptr)
+    {
+        used = engine_rrt;
+    }
+    if (used == engine_visibility && (cow_visibility == nullptr || cow_grid == nullptr))
+    {
+        used = engine_rrt;
+    }
+    if (used == engine_hierarchical && (cow_chunk_graph == nullptr || cow_chunk_graph->GetGrid() == nullptr))
+    {
+        used = engine_rrt;
+    }
+    if (used == engine_flow &&
+        (cow_flow_fields == nullptr || cow_var.current_area_index >= cow_flow_fields->GetFieldCount()))
     {
-        availab_act.push_back(functional_area.type);
+        used = engine_rrt;
     }
 
-    if (availab_act.empty())
+    // Routes from the same cell to the same area are shared by the herd. The route starts
+    // where another cow stood in the cell, so it is joined from here if the first leg is free.
+    PlanResult result;
+    if (IsCacheable(used) &&
+        cow_route_cache->Find(StartCell(), cow_var.current_area_index, used, CacheVariant(used),
+                              cow_grid->GetVersion(), result.path) &&
+        (result.path.size() < 2 || cow_map == nullptr || !cow_map->SegmentBlocked(cow_var.start, result.path[1])))
     {
-        throw std::runtime_error("There is not available functional area.");
+        result.path[0] = cow_var.start;
+        result.status = plan_found;
+        ApplyPlan(used, result);
+        refine_wanted = used == engine_rrt && mode == rrt_star;
+        return;
     }
 
-    // for (int aa : availab_act)
-    // {
-    //     std::cout << "availab_act: " << aa << std::endl;
-    // }
+    // Flow fields answer in O(1), everything else can go to the batch
+    plan_output.engine = used;
+    if (cow_batched && used != engine_flow)
+    {
+        State() = cow_planning;
+        return;
+    }
 
-    return availab_act;
+    assert(cow_scratch != nullptr);
+    RunPlanner(*cow_scratch, plan_output);
+    FinishPlan(plan_output);
 }
 
-b2Vec2 Cow::Get_target()
+void Cow::FinishPlan(PlanOutput &output)
 {
-    std::vector<int> available_activities;
-    available_activities = get_availabe_activities();
+    planner_engine used = output.engine;
+    PlanResult &result = output.result;
+
+    PlanStats &herd_stats = cow_herd->plan_stats;
+    EngineStats &stats = herd_stats.engines[used];
+    stats.plans += 1;
+    stats.expanded += result.iterations;
+    stats.milliseconds += output.milliseconds;
+    if (result.status == plan_found)
+    {
+        stats.found += 1;
+        stats.path_length += used == engine_flow ? cow_flow_fields->RouteLength(cow_var.current_area_index, cow_var.start)
+                                                 : PathLength(result.path);
+
+        if (IsCacheable(used))
+        {
+            cow_route_cache->Insert(StartCell(), cow_var.current_area_index, used, CacheVariant(used),
+                                    cow_grid->GetVersion(), result.path);
+        }
+    }
 
-    // std::cout << "cow_var.current_activity: " << cow_var.current_activity << std::endl;
+    if (used == engine_rrt)
+    {
+        for (int i = 0; i < rrt_mode_count; ++i)
+        {
+            ModeStats &modeStats = herd_stats.modes[i];
+            modeStats.plans += output.mode_stats[i].plans;
+            modeStats.found += output.mode_stats[i].found;
+            modeStats.iterations_to_solution += output.mode_stats[i].iterations_to_solution;
+            modeStats.raw_vertices += output.mode_stats[i].raw_vertices;
+            modeStats.smooth_vertices += output.mode_stats[i].smooth_vertices;
+        }
+        herd_stats.nearest.queries += output.nearest_stats.queries;
+        herd_stats.nearest.nodes_visited += output.nearest_stats.nodes_visited;
+    }
+
+    // Anytime plans hand their first path over, the owner keeps improving it
+    refine_wanted = used == engine_rrt && mode == rrt_star && result.status == plan_found;
 
-    int next_activity = next_manner_from_TM(cow_var.current_activity, available_activities);
-    std::vector<SampleFunctionalArea> matchingAreas;
+    ApplyPlan(used, result);
+}
 
-    for (auto func_ara : cow_layout)
+bool Cow::ApplyLayoutEdit(const std::vector<int> &area_remap, const ObstacleIndex &blocked)
+{
+    int area = cow_var.current_area_index;
+    int newArea = 0 <= area && area < int(area_remap.size()) ? area_remap[area] : -1;
+    if (newArea < 0)
     {
-        if (func_ara.type == next_activity)
-            matchingAreas.push_back(func_ara);
+        // Only matters on the way there, Get_target picks again otherwise
+        cow_var.current_area_index = 0;
+        if (State() == cow_traslating || State() == cow_planning)
+        {
+            cow_var.following_field = false;
+            State() = cow_starting;
+            return true;
+        }
+        return false;
     }
 
-    // std::cout << "matchingAreas: " << matchingAreas.size() << std::endl;
+    // A request still waiting for the batch will plan on the edited map, and flow
+    // fields were repaired in place
+    cow_var.current_area_index = newArea;
+    if (State() != cow_traslating || cow_var.following_field || cow_path.empty())
+    {
+        return false;
+    }
 
-    // Randomly select one from the matching areas
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, matchingAreas.size() - 1);
+    b2Vec2 from = b2Body_GetPosition(BodyId());
+    for (int i = WaypointIndex(); i < int(cow_path.size()); ++i)
+    {
+        if (blocked.SegmentBlocked(from, cow_path[i]))
+        {
+            PlanToTarget();
+            return true;
+        }
+        from = cow_path[i];
+    }
+    return false;
+}
 
-    cow_var.current_functional_area = matchingAreas[dis(gen)];
+bool Cow::AdoptRefinedPath(std::vector<b2Vec2> &path)
+{
+    if (State() != cow_traslating || cow_var.following_field || cow_path.empty() || path.size() < 2)
+    {
+        return false;
+    }
 
-    // std::cout << "cow_var.current_functional_area: " << cow_var.current_functional_area.type << std::endl;
+    b2Vec2 position = b2Body_GetPosition(BodyId());
+    float remaining = b2Distance(position, cow_path[WaypointIndex()]);
+    for (int i = WaypointIndex() + 1; i < int(cow_path.size()); ++i)
+    {
+        remaining += b2Distance(cow_path[i - 1], cow_path[i]);
+    }
 
-    // times 24 + 12 to match world
-    b2Vec2 goal;
-    goal = b2Vec2{cow_var.current_functional_area.x, cow_var.current_functional_area.y} * 24;
-    goal.x += 12;
-    goal.y += 12;
+    // The new path starts where the old one did, the cow has walked on since
+    int join = int(path.size()) - 1;
+    while (join > 0 && cow_map->SegmentBlocked(position, path[join]))
+    {
+        --join;
+    }
+    if (join == 0)
+    {
+        return false;
+    }
+
+    float refined = b2Distance(position, path[join]);
+    for (int i = join + 1; i < int(path.size()); ++i)
+    {
+        refined += b2Distance(path[i - 1], path[i]);
+    }
+
+    // Ignore gains too small to change how the cow walks
+    if (refined > remaining - 1.0f)
+    {
+        return false;
+    }
+
+    cow_path.swap(path);
+    WaypointIndex() = join;
+    cow_var.partial_path = false;
+    return true;
+}
+
+void Cow::ApplyPlan(planner_engine used, PlanResult &result)
+{
+    WaypointIndex() = 0;
+    cow_path.clear();
+
+    if (result.status == plan_unreachable)
+    {
+        // Walled in or out of budget without progress, wait and pick another target
+        WaitToRetry();
+        return;
+    }
+
+    if (result.status == plan_partial)
+    {
+        // RRT returns a partial path whenever its tree grew, even toward a goal the
+        // canvas walls in. Give up on the target once the partial plans stop closing in.
+        float gap = b2Distance(result.path.back(), Target());
+        if (gap < cow_var.partial_gap - cow_progress_distance)
+        {
+            cow_var.partial_gap = gap;
+            cow_var.failed_plans = 0;
+        }
+        else if (++cow_var.failed_plans >= cow_max_failed_plans)
+        {
+            WaitToRetry();
+            return;
+        }
+    }
+    else
+    {
+        cow_var.failed_plans = 0;
+        cow_var.partial_gap = FLT_MAX;
+    }
+
+    cow_path.swap(result.path);
+    cow_var.partial_path = result.status == plan_partial;
+    cow_var.following_field = used == engine_flow;
+    State() = cow_traslating;
+}
+
+void Cow::WaitToRetry()
+{
+    IdleSteps() = cow_retry_steps;
+    cow_var.partial_path = false;
+    cow_var.failed_plans = 0;
+    cow_var.partial_gap = FLT_MAX;
+    State() = cow_idling;
+}
+
+void Cow::StartActivity()
+{
+    cow_var.speed = 0;
+    WaypointIndex() = 0;
+    b2Body_SetLinearVelocity(BodyId(), b2Vec2_zero);
+    b2Body_SetAngularVelocity(BodyId(), 0.0f);
+
+    State() = cow_in_activity;
+    activity_started = true;
+}
+
+void Cow::EndActivity()
+{
+    assert(State() == cow_in_activity);
+    if (Get_target() < 0)
+    {
+        WaitToRetry();
+    }
+    else
+    {
+        PlanToTarget();
+    }
+}
+
+float Cow::ActivitySeconds() const
+{
+    return float(ACTIVITY_DURATION[cow_var.current_activity]);
+}
+
+void Cow::Steer(cow_pose cow_pose)
+{
+    if (cow_batched_steering)
+    {
+        // Toward cow_var.waypoint with the rest of the herd, after the routines
+        cow_herd->RequestSteering(cow_index);
+        return;
+    }
 
-    return goal;
+    Cow_control_to_point(cow_pose);
+    Cow_move_model(cow_pose);
 }
 
-void Cow::Routine()
+void Cow::Routine(const b2Transform &transform)
 {
     assert(m_isSpawned == true);
 
-    if (cow_var.state == cow_starting)
+    if (State() == cow_starting)
     {
 
-        cow_var.start = b2Body_GetPosition(bodyId);
-        cow_var.end = Get_target();
         // std::cout << "end: " << cow_var.end.x << "|" << cow_var.end.y << std::endl;
-        cow_path.clear();
-        nodes.clear();
-        cow_path = FindPath(cow_var.start, cow_var.end, cow_map, max_b_area, 24.0f, 56.0f);
-        cow_var.state = cow_traslating;
+        if (Get_target() < 0)
+        {
+            // No area to go to in this layout, an edit may add one
+            WaitToRetry();
+        }
+        else
+        {
+            PlanToTarget();
+        }
     }
-    else if (cow_var.state == cow_traslating)
+    else if (State() == cow_traslating)
     {
 
         // std::cout << cow_var.waypoint_index << "/" << cow_path.size() << std::endl;
         // std::cout << cow_path.back().x << "|" << cow_path.back().y << std::endl;
 
-        b2Vec2 position = b2Body_GetPosition(bodyId);
-        b2Rot rotation = b2Body_GetRotation(bodyId);
-        float angle = b2Rot_GetAngle(rotation);
+        b2Vec2 position = transform.p;
+        float angle = b2Rot_GetAngle(transform.q);
         cow_pose cow_pose;
         cow_pose.position = position;
         cow_pose.angle = angle;
 
+        if (cow_var.following_field)
+        {
+            flow_status status = cow_flow_fields->NextWaypoint(cow_var.current_area_index, position, &cow_var.waypoint);
+            if (status == flow_arrived)
+            {
+                StartActivity();
+            }
+            else if (status == flow_lost)
+            {
+                // Shoved somewhere the field does not reach
+                PlanToTarget();
+            }
+            else
+            {
+                Steer(cow_pose);
+            }
+            return;
+        }
+
         // cow_var.end = path[cow_var.waypoint_index];
-        cow_var.waypoint = cow_path[cow_var.waypoint_index];
-        Cow_control_to_point(cow_pose);
-        Cow_move_model(cow_pose);
+        cow_var.waypoint = cow_path[WaypointIndex()];
+        Steer(cow_pose);
 
         // Check if the robot is close enough to the target waypoint
         float distance_to_target = b2Distance(cow_pose.position, cow_var.waypoint);
         // std::cout << "distance_to_target: " << distance_to_target << std::endl;
 
-        if (distance_to_target < cow_waypoint_threshold)
+        // Smoothed paths turn at obstacle corners, only cut a corner once the next leg is in sight
+        bool last_waypoint = size_t(WaypointIndex()) + 1 >= cow_path.size();
+        bool reached = distance_to_target < cow_waypoint_corner_threshold;
+        if (!reached && distance_to_target < cow_waypoint_threshold)
+        {
+            reached = last_waypoint || cow_map == nullptr ||
+                      !cow_map->SegmentBlocked(cow_pose.position, cow_path[WaypointIndex() + 1]);
+        }
+
+        if (reached)
         {
             // Move to the next waypoint if available
-            if (cow_var.waypoint_index < cow_path.size() - 1)
+            if (!last_waypoint)
+            {
+                WaypointIndex()++;
+            }
+            else if (cow_var.partial_path)
             {
-                cow_var.waypoint_index++;
+                // Only got part of the way, try again from here
+                PlanToTarget();
             }
             else
             {
-                cow_var.speed = 0;
-                cow_var.waypoint_index = 0;
-
-                cow_var.state = cow_in_activity;
+                StartActivity();
             }
         }
     }
 
-    else if (cow_var.state == cow_idling)
+    else if (State() == cow_planning)
     {
+        cow_herd->RequestStop(cow_index);
+
+        // The owner's PlanBatch applies the plan
     }
-    else if (cow_var.state == cow_in_activity)
+    else if (State() == cow_idling)
     {
-        int time_doing = ACTIVITY_DURATION[cow_var.current_activity];
+        cow_herd->RequestStop(cow_index);
 
-        for (int i = 0; i < time_doing; i++)
+        // Waiting after a failed plan, then pick a new target
+        if (--IdleSteps() <= 0)
         {
+            State() = cow_starting;
         }
-        cow_var.start = b2Body_GetPosition(bodyId);
-        cow_var.end = Get_target();
-        cow_path.clear();
-        nodes.clear();
-        cow_path = FindPath(cow_var.start, cow_var.end, cow_map, max_b_area, 24.0f, 56.0f);
-  
-        cow_var.state = cow_traslating;
+    }
+    else if (State() == cow_in_activity)
+    {
+        // Nothing to do until the owner's timer calls EndActivity
     }
     // b2Vec2 currentTarget = path[cow_var.waypoint_index];
     // b2Vec2 position = b2Body_GetPosition(bodyId);
@@ -1,7 +1,13 @@
 #pragma once
 
+#include "activity_sampler.h"
+#include "barn_layout.h"
+#include "flow_field.h"
+#include "grid_planner.h"
+#include "hierarchical_planner.h"
+#include "route_cache.h"
 #include "rrt.h"
-#include "sample.h"
+#include "visibility_planner.h"
 
 #include "box2d/types.h"
 // Include the string library
@@ -15,6 +21,7 @@
 enum cow_states {
     cow_starting,
     cow_idling,
+    cow_planning, // waiting for a PlanBatch to plan the request
     cow_traslating,
     cow_in_activity,
 };
@@ -25,10 +32,16 @@ enum cow_definition
     cow_weight = 2,
     cow_color = b2_colorFloralWhite,
     cow_leg_base = 10,
+    cow_corner_radius = 7,
+    cow_clearance_margin = 2, // kept between the cow body and functional areas, see Barn::CreateLayout
     cow_desired_speed = 50,
     cow_max_speed = 30,
     cow_max_steering_angle = 1,
     cow_waypoint_threshold = 48,
+    cow_waypoint_corner_threshold = 12, // always switch this close, even without line of sight
+    cow_retry_steps = 60, // steps to idle after a target could not be reached
+    cow_max_failed_plans = 3, // partial plans in a row that get no closer before the cow gives up on a target
+    cow_progress_distance = 12, // how much closer a partial plan has to end to count as progress
 };
 
 struct
@@ -45,42 +58,138 @@ struct cow_pose
     float angle;
 };
 
-class Cow : public RRT
+// Planner working memory for one thread. A plan borrows it while it runs, so the
+// herd needs one per scheduler thread instead of one per cow.
+struct PlannerScratch
+{
+    RRT rrt;
+    GridPlanner grid;
+    VisibilityPlanner visibility;
+    HierarchicalPlanner hierarchical;
+    std::vector<std::pair<int, int>> goal_cells; // free sides of the target area
+    std::vector<b2Vec2> goal_points;             // their centres, for the visibility engine
+};
+
+// What one plan produced, filled on a worker and applied to the cow on the main thread
+struct PlanOutput
+{
+    planner_engine engine = engine_rrt;
+    PlanResult result;
+    float milliseconds = 0.0f;
+    ModeStats mode_stats[rrt_mode_count]; // counters this plan added
+    NearestStats nearest_stats;
+};
+
+// Counters of the finished plans of a whole herd
+struct PlanStats
+{
+    EngineStats engines[engine_count];
+    ModeStats modes[rrt_mode_count]; // RRT plans only
+    NearestStats nearest;
+};
+
+class Herd;
+
+class Cow
 {
 public:
     Cow();
     void Spawn(b2WorldId worldId, float x, float y, float orientation, float scale, float frictionTorque, float hertz,
                int groupIndex, void *userData);
     void Despawn();
-    b2BodyId bodyId;
     bool m_isSpawned;
+
+    // Row of the cow in its herd, the hot fields below live in the herd arrays
+    Herd *cow_herd;
+    int cow_index;
+    b2BodyId BodyId() const;
+    cow_states &State();
+    cow_states State() const;
+    int &WaypointIndex();
+    int WaypointIndex() const;
+    b2Vec2 &Target();
+    b2Vec2 Target() const;
+    int &IdleSteps();
+
     // std::vector<float, float> start;
     // std::vector<float, float> end;
-    void Routine();
+    void Routine(const b2Transform &transform); // transform of the body this step, see Herd::FetchPoses
     b2Vec2 cow_head = b2Vec2({10.5f, 1.0f});
     std::vector<b2Vec2> cow_path;
     b2Vec2 max_b_area;
 
     struct
     {
-        cow_states state;
         b2Vec2 start;
-        b2Vec2 end;
         b2Vec2 waypoint;
         float confidence;
-        int waypoint_index;
         float speed;
         float steering_angle;
         int current_activity;
         SampleFunctionalArea current_functional_area;
+        int current_area_index; // into cow_layout and the flow fields
+        bool partial_path; // path stops short of end, replan on arrival
+        int failed_plans; // partial plans in a row that got no closer to the target
+        float partial_gap; // closest the partial plans for this target got to it
+        bool following_field; // steering from the flow field instead of cow_path
     } cow_var;
 
+    PlanBudget plan_budget;
+    planner_engine engine = engine_rrt;
+    // RRT settings, the tree grows in the planner scratch
+    rrt_mode mode = rrt_uniform;
+    float goal_bias = 0.1f;
+    bool use_node_grid = true;
+    int brute_force_limit = 32;
+    bool smooth_paths = true;
+    RandomStream random; // seeded for every plan
+    void SeedRandom(uint64_t seed); // call before Spawn, from MixSeed(scenario seed, cow index)
+    RandomStream cow_random;        // activities, targets and the body
+    uint64_t cow_seed;
+    uint32_t plan_count; // plan n is seeded with MixSeed(cow_seed, n)
+
+    PlanOutput plan_output;
+    void PlanToTarget();
+    void RunPlanner(PlannerScratch &scratch, PlanOutput &output) const; // safe on any thread
+    void FinishPlan(PlanOutput &output); // records the cost, caches and applies the path
+    void ApplyPlan(planner_engine used, PlanResult &result);
+    void WaitToRetry(); // idles for cow_retry_steps, then picks another target
+    bool IsCacheable(planner_engine used) const;
+    int CacheVariant(planner_engine used) const; // the route cache keeps RRT modes apart
+    // After a layout edit: follows the target to its new layout index and replans when
+    // the target is gone or blocked cuts the rest of the path. True if the cow replanned.
+    bool ApplyLayoutEdit(const std::vector<int> &area_remap, const ObstacleIndex &blocked);
+    // A shorter path for the current trip, joined at the furthest waypoint in sight. Kept
+    // only if it shortens the rest of the walk, takes the path when it does.
+    bool AdoptRefinedPath(std::vector<b2Vec2> &path);
+    bool refine_wanted; // the last plan found an rrt_star path the owner may refine
+
+    // Arriving starts the activity and sets activity_started, the owner then times it
+    // and calls EndActivity once ActivitySeconds of simulated time have passed
+    void StartActivity();
+    void EndActivity();
+    float ActivitySeconds() const;
+    bool activity_started;
+    int StartCell() const;
+
     void Cow_move_model(cow_pose);
     void Cow_control_to_point(cow_pose);
+    void Steer(cow_pose); // now or in the herd batch, see cow_batched_steering
     // void Find_path(RRT rrt);
-    std::vector<SampleFunctionalArea> cow_layout;
-    std::vector<b2AABB> cow_map;
+    // Shared with the whole herd, owned by the MapMaker of the barn
+    const std::vector<SampleFunctionalArea> *cow_layout;
+    const ObstacleIndex *cow_map;
+    const OccupancyGrid *cow_grid;
+    PlannerScratch *cow_scratch; // used by plans made on the calling thread
+    const FlowFields *cow_flow_fields;
+    const VisibilityGraph *cow_visibility;
+    const ChunkGraph *cow_chunk_graph;
+    const ActivitySampler *cow_activities; // transition tables of the layout
+    RouteCache *cow_route_cache; // shared by the herd, nullptr plans every trip
+    bool cow_batched; // leave requests in cow_planning for the owner's PlanBatch
+    bool cow_batched_steering; // leave the controller to the owner's Herd::Steer
 
-    b2Vec2 Get_target();
-    std::vector<int> get_availabe_activities();
+    // Picks the next activity and an area for it and sets Target. The area index, or -1
+    // when the layout has no area for an activity that can follow the current one.
+    int Get_target();
 };
\ No newline at end of file
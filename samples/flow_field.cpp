@@ -0,0 +1,398 @@
+#include "flow_field.h"
+
+#include "box2d/math_functions.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include <stdlib.h>
+
+namespace
+{
+// Neighbour offsets, a cell stores the index of the step toward its destination
+const int k_stepX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int k_stepY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// Fixed point step costs, 1 and the square root of 2 scaled by k_costScale
+const int k_costScale = 5;
+const int k_stepCost[8] = {5, 7, 5, 7, 5, 7, 5, 7};
+} // namespace
+
+FlowFields::FlowFields()
+{
+    m_grid = nullptr;
+    m_width = 0;
+    m_cellCount = 0;
+    m_stamp = 0;
+}
+
+void FlowFields::Reset(const OccupancyGrid &grid)
+{
+    m_grid = &grid;
+    m_width = grid.GetWidth();
+    m_cellCount = grid.GetCellCount();
+    m_fields.clear();
+    m_marks.assign(m_cellCount, 0);
+    m_stamp = 0;
+}
+
+void FlowFields::Clear()
+{
+    m_grid = nullptr;
+    m_width = 0;
+    m_cellCount = 0;
+    m_fields.clear();
+    m_marks.clear();
+}
+
+int FlowFields::AddField(const std::vector<std::pair<int, int>> &target_cells)
+{
+    int field = int(m_fields.size());
+    m_fields.emplace_back();
+    SetField(field, target_cells);
+    return field;
+}
+
+void FlowFields::SetField(int field, const std::vector<std::pair<int, int>> &target_cells)
+{
+    assert(0 <= field && field < int(m_fields.size()));
+    Field &f = m_fields[field];
+    f.targets = target_cells;
+    f.directions.assign(m_cellCount, e_unreachable);
+    f.costs.assign(m_cellCount, e_maxCost);
+    m_open.clear();
+
+    // Seed with the free cells on the sides of the destination
+    for (const std::pair<int, int> &target : target_cells)
+    {
+        for (int i = 0; i < 8; i += 2)
+        {
+            int x = target.first + k_stepX[i];
+            int y = target.second + k_stepY[i];
+            if (!m_grid->IsInside(x, y) || m_grid->IsBlocked(x, y))
+            {
+                continue;
+            }
+
+            int cell = y * m_width + x;
+            if (f.costs[cell] > 0)
+            {
+                f.costs[cell] = 0;
+                f.directions[cell] = e_goal;
+                m_open.push_back({0, cell});
+            }
+        }
+    }
+
+    Propagate(f);
+}
+
+void FlowFields::RemapFields(const std::vector<int> &field_remap, int field_count)
+{
+    std::vector<Field> fields(field_count);
+    for (int i = 0; i < int(field_remap.size()) && i < int(m_fields.size()); ++i)
+    {
+        if (field_remap[i] >= 0)
+        {
+            fields[field_remap[i]] = std::move(m_fields[i]);
+        }
+    }
+
+    for (Field &field : fields)
+    {
+        if (field.directions.empty())
+        {
+            field.directions.assign(m_cellCount, e_unreachable);
+            field.costs.assign(m_cellCount, e_maxCost);
+        }
+    }
+    m_fields.swap(fields);
+}
+
+int FlowFields::RepairFields(const std::vector<std::pair<int, int>> &changed_cells)
+{
+    int touched = 0;
+    for (Field &field : m_fields)
+    {
+        if (!field.targets.empty())
+        {
+            touched += RepairField(field, changed_cells);
+        }
+    }
+    return touched;
+}
+
+bool FlowFields::CanStep(int x, int y, int direction) const
+{
+    int nx = x + k_stepX[direction];
+    int ny = y + k_stepY[direction];
+    if (m_grid->IsBlocked(nx, ny))
+    {
+        return false;
+    }
+
+    // Same corner rule as the grid planners, diagonals need both sides free
+    return (direction & 1) == 0 || (!m_grid->IsBlocked(nx, y) && !m_grid->IsBlocked(x, ny));
+}
+
+bool FlowFields::IsSeed(const Field &field, int x, int y) const
+{
+    for (const std::pair<int, int> &target : field.targets)
+    {
+        if (std::abs(target.first - x) + std::abs(target.second - y) == 1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int FlowFields::Propagate(Field &field)
+{
+    std::greater<std::pair<int, int>> later;
+    std::make_heap(m_open.begin(), m_open.end(), later);
+
+    int settled = 0;
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(), later);
+        std::pair<int, int> node = m_open.back();
+        m_open.pop_back();
+        if (node.first > field.costs[node.second])
+        {
+            continue;
+        }
+
+        settled += 1;
+        int x = node.second % m_width;
+        int y = node.second / m_width;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (!CanStep(x, y, i))
+            {
+                continue;
+            }
+
+            int next = (y + k_stepY[i]) * m_width + x + k_stepX[i];
+            int cost = node.first + k_stepCost[i];
+            uint8_t back = uint8_t((i + 4) & 7); // the neighbour steps back toward this cell
+            if (cost < field.costs[next])
+            {
+                field.costs[next] = uint16_t(cost);
+                field.directions[next] = back;
+                m_open.push_back({cost, next});
+                std::push_heap(m_open.begin(), m_open.end(), later);
+            }
+            else if (cost == field.costs[next] && back < field.directions[next])
+            {
+                // Ties go to the lowest direction whatever the pop order, so a repair ends
+                // with the same field as a fresh build
+                field.directions[next] = back;
+            }
+        }
+    }
+    return settled;
+}
+
+int FlowFields::RepairField(Field &field, const std::vector<std::pair<int, int>> &changed_cells)
+{
+    m_stamp += 1;
+    m_stack.clear();
+    m_affected.clear();
+    m_open.clear();
+
+    // Roots of the damage: the edited cells and the diagonal steps they now cut
+    for (const std::pair<int, int> &changed : changed_cells)
+    {
+        m_stack.push_back(changed.second * m_width + changed.first);
+        for (int i = 0; i < 8; ++i)
+        {
+            int x = changed.first + k_stepX[i];
+            int y = changed.second + k_stepY[i];
+            if (!m_grid->IsInside(x, y))
+            {
+                continue;
+            }
+
+            uint8_t direction = field.directions[y * m_width + x];
+            if (direction < e_goal && (direction & 1) && !CanStep(x, y, direction))
+            {
+                m_stack.push_back(y * m_width + x);
+            }
+        }
+    }
+
+    // Every cell whose route ran through a root loses its cost, found by walking the tree down
+    while (!m_stack.empty())
+    {
+        int cell = m_stack.back();
+        m_stack.pop_back();
+        if (m_marks[cell] == m_stamp)
+        {
+            continue;
+        }
+
+        m_marks[cell] = m_stamp;
+        field.costs[cell] = e_maxCost;
+        field.directions[cell] = e_unreachable;
+        m_affected.push_back(cell);
+
+        int x = cell % m_width;
+        int y = cell / m_width;
+        for (int i = 0; i < 8; ++i)
+        {
+            int cx = x + k_stepX[i];
+            int cy = y + k_stepY[i];
+            if (!m_grid->IsInside(cx, cy))
+            {
+                continue;
+            }
+
+            // A child steps back onto this cell
+            uint8_t direction = field.directions[cy * m_width + cx];
+            if (direction < e_goal && direction == ((i + 4) & 7))
+            {
+                m_stack.push_back(cy * m_width + cx);
+            }
+        }
+    }
+
+    // Reseed the free cells of the damage from the intact cells around them
+    for (int cell : m_affected)
+    {
+        int x = cell % m_width;
+        int y = cell / m_width;
+        if (m_grid->IsBlocked(x, y))
+        {
+            continue;
+        }
+
+        if (IsSeed(field, x, y))
+        {
+            field.costs[cell] = 0;
+            field.directions[cell] = e_goal;
+            m_open.push_back({0, cell});
+            continue;
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            if (!CanStep(x, y, i))
+            {
+                continue;
+            }
+
+            int next = (y + k_stepY[i]) * m_width + x + k_stepX[i];
+            if (m_marks[next] == m_stamp || field.costs[next] == e_maxCost)
+            {
+                continue;
+            }
+
+            int cost = field.costs[next] + k_stepCost[i];
+            if (cost < field.costs[cell])
+            {
+                field.costs[cell] = uint16_t(cost);
+                field.directions[cell] = uint8_t(i);
+            }
+        }
+
+        if (field.costs[cell] < e_maxCost)
+        {
+            m_open.push_back({field.costs[cell], cell});
+        }
+    }
+
+    // A freed cell also opens diagonals between its neighbours, let them relax again
+    for (const std::pair<int, int> &changed : changed_cells)
+    {
+        if (m_grid->IsBlocked(changed.first, changed.second))
+        {
+            continue;
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            int x = changed.first + k_stepX[i];
+            int y = changed.second + k_stepY[i];
+            if (m_grid->IsInside(x, y) && field.costs[y * m_width + x] < e_maxCost)
+            {
+                m_open.push_back({field.costs[y * m_width + x], y * m_width + x});
+            }
+        }
+    }
+
+    return int(m_affected.size()) + Propagate(field);
+}
+
+bool FlowFields::StartCell(b2Vec2 position, int *x, int *y) const
+{
+    m_grid->WorldToCell(position, x, y);
+    if (!m_grid->IsBlocked(*x, *y))
+    {
+        return true;
+    }
+
+    // Pushed onto a blocked cell, head for the closest free one
+    return m_grid->FindFreeCell(position, x, y);
+}
+
+flow_status FlowFields::NextWaypoint(int field, b2Vec2 position, b2Vec2 *waypoint) const
+{
+    assert(0 <= field && field < int(m_fields.size()));
+    int x, y;
+    int cellX, cellY;
+    m_grid->WorldToCell(position, &cellX, &cellY);
+    if (!StartCell(position, &x, &y))
+    {
+        return flow_lost;
+    }
+
+    uint8_t direction = Direction(field, x, y);
+    if (direction == e_unreachable)
+    {
+        return flow_lost;
+    }
+
+    if (x != cellX || y != cellY)
+    {
+        *waypoint = m_grid->CellCenter(x, y);
+        return flow_moving;
+    }
+
+    if (direction == e_goal)
+    {
+        return flow_arrived;
+    }
+
+    // Follow the first step, then keep going while the field runs straight
+    int first = direction;
+    for (int i = 0; i < lookahead_cells && direction == first; ++i)
+    {
+        x += k_stepX[direction];
+        y += k_stepY[direction];
+        direction = Direction(field, x, y);
+    }
+
+    *waypoint = m_grid->CellCenter(x, y);
+    return flow_moving;
+}
+
+float FlowFields::RouteLength(int field, b2Vec2 position) const
+{
+    int x, y;
+    if (!StartCell(position, &x, &y))
+    {
+        return 0.0f;
+    }
+
+    float length = 0.0f;
+    uint8_t direction = Direction(field, x, y);
+    while (direction < e_goal)
+    {
+        length += k_stepCost[direction];
+        x += k_stepX[direction];
+        y += k_stepY[direction];
+        direction = Direction(field, x, y);
+    }
+    return length * m_grid->GetCellSize() / k_costScale;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "occupancy_grid.h"
+
+#include "box2d/types.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+enum flow_status
+{
+    flow_moving,  // waypoint holds the next point to steer to
+    flow_arrived, // on a cell next to the destination
+    flow_lost,    // the destination cannot be reached from here
+};
+
+// One direction field per destination, built with a Dijkstra pass outward from
+// the free cells around the destination. Each cell stores a single byte with the
+// neighbour to step to, so following a field costs no planning at all.
+//
+// The fields also keep their costs, which makes each one a search tree rooted at
+// its destination. After a layout edit RepairFields only redoes the part of the
+// tree that went through the edited cells, in the spirit of LPA*. The costs are
+// fixed point in two bytes, so a field takes three bytes per cell in all.
+class FlowFields
+{
+public:
+    FlowFields();
+
+    void Reset(const OccupancyGrid &grid); // drops every field, the grid must outlive the fields
+    void Clear();
+
+    // Field toward the free cells beside target_cells, returns the field index
+    int AddField(const std::vector<std::pair<int, int>> &target_cells);
+    void SetField(int field, const std::vector<std::pair<int, int>> &target_cells); // rebuilds one field
+
+    // Moves field i to field_remap[i] and drops it when that is -1. Slots nothing maps
+    // to stay unreachable until SetField fills them.
+    void RemapFields(const std::vector<int> &field_remap, int field_count);
+
+    // Call after the cells changed in the grid. Returns the number of cells the repair
+    // touched, which follows the size of the edit instead of the size of the barn.
+    int RepairFields(const std::vector<std::pair<int, int>> &changed_cells);
+
+    // Point to steer to from position, looks ahead along straight runs so the cow keeps its speed
+    flow_status NextWaypoint(int field, b2Vec2 position, b2Vec2 *waypoint) const;
+
+    // Length of the route from position, walks the field, so keep it off the per step path
+    float RouteLength(int field, b2Vec2 position) const;
+
+    int GetFieldCount() const { return int(m_fields.size()); }
+
+    // Raw cell state for tests, the cost is in fixed point and e_maxCost off the field
+    uint8_t GetDirection(int field, int x, int y) const { return Direction(field, x, y); }
+    int GetCost(int field, int x, int y) const { return m_fields[field].costs[y * m_width + x]; }
+
+    int lookahead_cells = 3;
+
+private:
+    enum
+    {
+        e_goal = 8,
+        e_unreachable = 255,
+        e_maxCost = 0xffff, // longer routes read as unreachable, 0xffff / k_costScale is 13107 straight cells, far beyond the 100 x 100 barn
+    };
+
+    struct Field
+    {
+        std::vector<std::pair<int, int>> targets;
+        std::vector<uint8_t> directions; // one byte per cell
+        std::vector<uint16_t> costs;     // e_maxCost where unreachable
+    };
+
+    uint8_t Direction(int field, int x, int y) const { return m_fields[field].directions[y * m_width + x]; }
+    bool StartCell(b2Vec2 position, int *x, int *y) const;
+    bool CanStep(int x, int y, int direction) const;
+    bool IsSeed(const Field &field, int x, int y) const;
+    int Propagate(Field &field); // returns the cells settled
+    int RepairField(Field &field, const std::vector<std::pair<int, int>> &changed_cells);
+
+    const OccupancyGrid *m_grid;
+    int m_width;
+    int m_cellCount;
+
+    std::vector<Field> m_fields;
+
+    // Dijkstra and repair scratch, reused by every field
+    std::vector<std::pair<int, int>> m_open;
+    std::vector<int> m_marks; // stamped, so the repair never clears the grid
+    int m_stamp;
+    std::vector<int> m_stack;
+    std::vector<int> m_affected;
+};
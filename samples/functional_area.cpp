@@ -22,17 +22,12 @@ void FunctionalArea::Spawn(b2WorldId worldId, float x, float y, int type, int or
 {
 	assert(m_isSpawned == false);
 
-	// from grid to world
-	x *= 24.0f;
-	y *= 24.0f;
-	x += 12.0f;
-	y += 12.0f;
-	if (orientation == 1) // vertical
-		y += 12.0f;
-	if (orientation == 2) // horizontal
-		x += 12.0f;
-
-	aabb = m.ConvertToABB(x, y, orientation);
+	SampleFunctionalArea area = {type, orientation, x, y};
+	b2Vec2 center = MapMaker::AreaCenter(area);
+	x = center.x;
+	y = center.y;
+
+	aabb = m.AreaAABB(area);
 
 	b2BodyDef bodyDef = b2DefaultBodyDef();
 	bodyDef.type = b2_staticBody;
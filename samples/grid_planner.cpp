@@ -0,0 +1,332 @@
+#include "grid_planner.h"
+#include "path_smoothing.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <float.h>
+
+GridPlanner::GridPlanner()
+{
+    m_grid = nullptr;
+    m_stamp = 0;
+}
+
+float GridPlanner::Heuristic(int x, int y) const
+{
+    // The closest goal, an area has at most six sides
+    float dist = FLT_MAX;
+    for (const std::pair<int, int> &goal : m_goals)
+    {
+        dist = b2MinFloat(dist, Octile(goal.first - x, goal.second - y));
+    }
+    return dist;
+}
+
+void GridPlanner::Prepare(const OccupancyGrid &grid)
+{
+    m_grid = &grid;
+    int cellCount = grid.GetCellCount();
+    if (cellCount > int(m_costs.size()))
+    {
+        m_costs.resize(cellCount);
+        m_parents.resize(cellCount);
+        m_seenStamps.resize(cellCount, m_stamp);
+        m_closedStamps.resize(cellCount, m_stamp);
+        m_goalStamps.resize(cellCount, m_stamp);
+    }
+
+    // Bumping the stamp forgets the previous plan without touching the cells
+    ++m_stamp;
+    m_open.clear();
+}
+
+void GridPlanner::Push(int x, int y, int parent, float g)
+{
+    int cell = CellIndex(x, y);
+    if (m_closedStamps[cell] == m_stamp || (m_seenStamps[cell] == m_stamp && m_costs[cell] <= g))
+    {
+        return;
+    }
+
+    m_costs[cell] = g;
+    m_parents[cell] = parent;
+    m_seenStamps[cell] = m_stamp;
+
+    m_open.push_back({g + Heuristic(x, y), g, cell});
+    std::push_heap(m_open.begin(), m_open.end(),
+                   [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+}
+
+PlanResult GridPlanner::FindPath(b2Vec2 start, const std::vector<std::pair<int, int>> &goal_cells,
+                                 const OccupancyGrid &grid, bool jump_points, const PlanBudget &budget)
+{
+    PlanResult result;
+    int startX, startY;
+    if (grid.GetCellCount() == 0 || !grid.FindFreeCell(start, &startX, &startY))
+    {
+        return result;
+    }
+
+    Prepare(grid);
+    m_goals.clear();
+    for (const std::pair<int, int> &goal : goal_cells)
+    {
+        if (grid.IsInside(goal.first, goal.second) && !grid.IsBlocked(goal.first, goal.second))
+        {
+            m_goalStamps[CellIndex(goal.first, goal.second)] = m_stamp;
+            m_goals.push_back(goal);
+        }
+    }
+    if (m_goals.empty())
+    {
+        return result;
+    }
+
+    Push(startX, startY, -1, 0.0f);
+
+    int startCell = CellIndex(startX, startY);
+    int closest = startCell;
+    float closestDist = Heuristic(startX, startY);
+    bool exhausted = true;
+
+    b2Timer timer = b2CreateTimer();
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(),
+                      [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+        OpenNode node = m_open.back();
+        m_open.pop_back();
+
+        if (m_closedStamps[node.cell] == m_stamp || node.g > m_costs[node.cell])
+        {
+            continue;
+        }
+        m_closedStamps[node.cell] = m_stamp;
+        ++result.iterations;
+
+        if (m_goalStamps[node.cell] == m_stamp)
+        {
+            result.status = plan_found;
+            BuildPath(node.cell, result.path);
+            return result;
+        }
+
+        int x = node.cell % grid.GetWidth();
+        int y = node.cell / grid.GetWidth();
+        float dist = Heuristic(x, y);
+        if (dist < closestDist)
+        {
+            closest = node.cell;
+            closestDist = dist;
+        }
+
+        if (jump_points)
+        {
+            ExpandJumpPoints(x, y, node.g);
+        }
+        else
+        {
+            ExpandNeighbours(x, y, node.g);
+        }
+
+        // Reading the clock is not free, check it every few iterations
+        if (result.iterations >= budget.max_iterations ||
+            ((result.iterations & 63) == 0 && budget.max_milliseconds > 0.0f &&
+             b2GetMilliseconds(&timer) > budget.max_milliseconds))
+        {
+            exhausted = false;
+            break;
+        }
+    }
+
+    if (!exhausted && closest != startCell)
+    {
+        result.status = plan_partial;
+        BuildPath(closest, result.path);
+    }
+    return result;
+}
+
+void GridPlanner::ExpandNeighbours(int x, int y, float g)
+{
+    int parent = CellIndex(x, y);
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            if ((dx == 0 && dy == 0) || !IsFree(x + dx, y + dy))
+            {
+                continue;
+            }
+
+            if (dx != 0 && dy != 0)
+            {
+                if (IsFree(x + dx, y) && IsFree(x, y + dy))
+                {
+                    Push(x + dx, y + dy, parent, g + k_diagonalCost);
+                }
+            }
+            else
+            {
+                Push(x + dx, y + dy, parent, g + 1.0f);
+            }
+        }
+    }
+}
+
+void GridPlanner::ExpandJumpPoints(int x, int y, float g)
+{
+    int cell = CellIndex(x, y);
+    int parent = m_parents[cell];
+
+    // Directions worth searching, pruned by the direction we arrived from
+    int directions[8][2];
+    int count = 0;
+    if (parent < 0)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if ((dx != 0 || dy != 0) && IsFree(x + dx, y + dy) && IsFree(x + dx, y) && IsFree(x, y + dy))
+                {
+                    directions[count][0] = dx;
+                    directions[count][1] = dy;
+                    ++count;
+                }
+            }
+        }
+    }
+    else
+    {
+        int px = parent % m_grid->GetWidth();
+        int py = parent / m_grid->GetWidth();
+        int dx = b2ClampInt(x - px, -1, 1);
+        int dy = b2ClampInt(y - py, -1, 1);
+
+        if (dx != 0 && dy != 0)
+        {
+            bool freeX = IsFree(x + dx, y);
+            bool freeY = IsFree(x, y + dy);
+            if (freeY)
+            {
+                directions[count][0] = 0;
+                directions[count][1] = dy;
+                ++count;
+            }
+            if (freeX)
+            {
+                directions[count][0] = dx;
+                directions[count][1] = 0;
+                ++count;
+            }
+            if (freeX && freeY && IsFree(x + dx, y + dy))
+            {
+                directions[count][0] = dx;
+                directions[count][1] = dy;
+                ++count;
+            }
+        }
+        else
+        {
+            // Straight moves, the sides may hold forced neighbours
+            int sideX = dy != 0 ? 1 : 0;
+            int sideY = dx != 0 ? 1 : 0;
+            bool freeNext = IsFree(x + dx, y + dy);
+            for (int side = -1; side <= 1; side += 2)
+            {
+                int sx = side * sideX;
+                int sy = side * sideY;
+                if (!IsFree(x + sx, y + sy))
+                {
+                    continue;
+                }
+
+                directions[count][0] = sx;
+                directions[count][1] = sy;
+                ++count;
+                if (freeNext && IsFree(x + dx + sx, y + dy + sy))
+                {
+                    directions[count][0] = dx + sx;
+                    directions[count][1] = dy + sy;
+                    ++count;
+                }
+            }
+            if (freeNext)
+            {
+                directions[count][0] = dx;
+                directions[count][1] = dy;
+                ++count;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        int jumpX, jumpY;
+        if (Jump(x + directions[i][0], y + directions[i][1], directions[i][0], directions[i][1], &jumpX, &jumpY))
+        {
+            Push(jumpX, jumpY, cell, g + Octile(jumpX - x, jumpY - y));
+        }
+    }
+}
+
+bool GridPlanner::Jump(int x, int y, int dx, int dy, int *jump_x, int *jump_y) const
+{
+    // (x, y) is the first cell of the run, the step into it is already known to be legal
+    while (IsFree(x, y))
+    {
+        bool jumpPoint = false;
+        if (IsGoal(x, y))
+        {
+            jumpPoint = true;
+        }
+        else if (dx != 0 && dy != 0)
+        {
+            // A diagonal run stops where one of its straight runs finds something
+            int unused_x, unused_y;
+            jumpPoint = Jump(x + dx, y, dx, 0, &unused_x, &unused_y) || Jump(x, y + dy, 0, dy, &unused_x, &unused_y);
+        }
+        else if (dx != 0)
+        {
+            jumpPoint = (IsFree(x, y - 1) && !IsFree(x - dx, y - 1)) || (IsFree(x, y + 1) && !IsFree(x - dx, y + 1));
+        }
+        else
+        {
+            jumpPoint = (IsFree(x - 1, y) && !IsFree(x - 1, y - dy)) || (IsFree(x + 1, y) && !IsFree(x + 1, y - dy));
+        }
+
+        if (jumpPoint)
+        {
+            *jump_x = x;
+            *jump_y = y;
+            return true;
+        }
+
+        // Diagonal steps may not cut corners
+        if (dx != 0 && dy != 0 && (!IsFree(x + dx, y) || !IsFree(x, y + dy)))
+        {
+            return false;
+        }
+
+        x += dx;
+        y += dy;
+    }
+    return false;
+}
+
+void GridPlanner::BuildPath(int cell, std::vector<b2Vec2> &path) const
+{
+    path.clear();
+    int width = m_grid->GetWidth();
+    while (cell >= 0)
+    {
+        path.push_back(m_grid->CellCenter(cell % width, cell / width));
+        cell = m_parents[cell];
+    }
+    std::reverse(path.begin(), path.end());
+
+    // A* stores every cell of a straight run
+    RemoveCollinearPoints(path, 0.01f);
+}
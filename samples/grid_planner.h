@@ -0,0 +1,57 @@
+#pragma once
+
+#include "occupancy_grid.h"
+#include "planner.h"
+
+#include "box2d/types.h"
+
+#include <utility>
+#include <vector>
+
+// A* and Jump Point Search over the occupancy grid with the octile heuristic.
+// Diagonal moves may not cut the corner of a blocked cell. A start that falls on a
+// blocked cell is moved to the closest free cell. The plan ends on whichever goal
+// cell it reaches first, the free sides of a functional area like its flow field,
+// so one walled in side does not hide the others. Paths are cell centres with
+// straight runs compressed.
+//
+// The scratch arrays are stamped, so a planner sized for a grid plans again
+// without clearing or allocating.
+class GridPlanner
+{
+public:
+    GridPlanner();
+
+    PlanResult FindPath(b2Vec2 start, const std::vector<std::pair<int, int>> &goal_cells, const OccupancyGrid &grid,
+                        bool jump_points, const PlanBudget &budget);
+
+private:
+    struct OpenNode
+    {
+        float f;
+        float g;
+        int cell;
+    };
+
+    int CellIndex(int x, int y) const { return y * m_grid->GetWidth() + x; }
+    float Heuristic(int x, int y) const;
+    void Prepare(const OccupancyGrid &grid);
+    void Push(int x, int y, int parent, float g);
+    void ExpandNeighbours(int x, int y, float g);
+    void ExpandJumpPoints(int x, int y, float g);
+    bool Jump(int x, int y, int dx, int dy, int *jump_x, int *jump_y) const;
+    bool IsFree(int x, int y) const { return !m_grid->IsBlocked(x, y); }
+    bool IsGoal(int x, int y) const { return m_goalStamps[CellIndex(x, y)] == m_stamp; }
+    void BuildPath(int cell, std::vector<b2Vec2> &path) const;
+
+    const OccupancyGrid *m_grid;
+    int m_stamp;
+    std::vector<std::pair<int, int>> m_goals; // the free goal cells of the query
+
+    std::vector<float> m_costs;   // cost from the start, valid if the stamp matches
+    std::vector<int> m_parents;   // cell the cost came from
+    std::vector<int> m_seenStamps;
+    std::vector<int> m_closedStamps;
+    std::vector<int> m_goalStamps;
+    std::vector<OpenNode> m_open; // binary heap, stale entries are skipped on pop
+};
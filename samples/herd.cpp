@@ -0,0 +1,247 @@
+#include "herd.h"
+
+#include "box2d/box2d.h"
+
+#include <assert.h>
+
+Herd::Herd()
+{
+}
+
+void Herd::Create(int count)
+{
+    Clear();
+
+    body_ids.assign(count, b2_nullBodyId);
+    states.assign(count, cow_starting);
+    waypoint_indices.assign(count, 0);
+    targets.assign(count, b2Vec2_zero);
+    idle_steps.assign(count, 0);
+    poses.assign(count, b2Transform_identity);
+
+    m_cows.resize(count);
+    m_active.resize(count);
+    m_rest.resize(count);
+    m_activeSlots.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        m_cows[i].cow_herd = this;
+        m_cows[i].cow_index = i;
+        m_active[i] = i;
+        m_activeSlots[i] = i;
+    }
+}
+
+void Herd::Clear()
+{
+    for (Cow &cow : m_cows)
+    {
+        if (cow.m_isSpawned)
+        {
+            cow.Despawn();
+        }
+    }
+
+    m_cows.clear();
+    m_active.clear();
+    m_activeSlots.clear();
+    m_rest.clear();
+    m_steered.clear();
+    m_stopped.clear();
+    m_steering.Clear();
+    m_bodies.clear();
+    m_transforms.clear();
+    m_velocities.clear();
+    m_angularVelocities.clear();
+    body_ids.clear();
+    states.clear();
+    waypoint_indices.clear();
+    targets.clear();
+    idle_steps.clear();
+    poses.clear();
+    plan_stats = PlanStats();
+}
+
+void Herd::Activate(int cow)
+{
+    if (m_activeSlots[cow] >= 0)
+    {
+        return;
+    }
+
+    m_activeSlots[cow] = int(m_active.size());
+    m_active.push_back(cow);
+    if (m_restBusyCows)
+    {
+        Wake(cow);
+    }
+}
+
+void Herd::Deactivate(int cow)
+{
+    int slot = m_activeSlots[cow];
+    if (slot < 0)
+    {
+        return;
+    }
+
+    int last = m_active.back();
+    m_active[slot] = last;
+    m_activeSlots[last] = slot;
+    m_active.pop_back();
+    m_activeSlots[cow] = -1;
+    if (m_restBusyCows)
+    {
+        Rest(cow);
+    }
+}
+
+void Herd::SetRestBusyCows(bool flag)
+{
+    if (flag == m_restBusyCows)
+    {
+        return;
+    }
+
+    m_restBusyCows = flag;
+    for (int cow = 0; cow < GetCount(); ++cow)
+    {
+        if (IsActive(cow) == false)
+        {
+            flag ? Rest(cow) : Wake(cow);
+        }
+    }
+}
+
+void Herd::Rest(int cow)
+{
+    b2BodyId bodyId = body_ids[cow];
+    b2ShapeId shapeId;
+    if (B2_IS_NULL(bodyId) || b2Body_GetShapes(bodyId, &shapeId, 1) == 0)
+    {
+        return;
+    }
+
+    // Moving cows and the barn still collide with a resting cow, other resting cows do
+    // not. So a crowd at a feeder is no chain of contacts, a cow that walks into it
+    // only wakes the cows it touches. The new category drops the contacts of the cow,
+    // and putting it to sleep splits it out of the island of any moving cow.
+    RestState &rest = m_rest[cow];
+    rest.filter = b2Shape_GetFilter(shapeId);
+    rest.linear_damping = b2Body_GetLinearDamping(bodyId);
+    rest.angular_damping = b2Body_GetAngularDamping(bodyId);
+
+    b2Filter filter = rest.filter;
+    filter.categoryBits = e_restingCategory;
+    filter.maskBits &= ~uint64_t(e_restingCategory);
+    b2Shape_SetFilter(shapeId, filter);
+
+    // Nothing slows a shoved cow on the barn floor, a resting one stands its ground
+    // and goes back to sleep
+    b2Body_SetLinearDamping(bodyId, resting_damping);
+    b2Body_SetAngularDamping(bodyId, resting_damping);
+    b2Body_SetLinearVelocity(bodyId, b2Vec2_zero);
+    b2Body_SetAngularVelocity(bodyId, 0.0f);
+    b2Body_SetAwake(bodyId, false);
+}
+
+void Herd::Wake(int cow)
+{
+    b2BodyId bodyId = body_ids[cow];
+    b2ShapeId shapeId;
+    if (B2_IS_NULL(bodyId) || b2Body_GetShapes(bodyId, &shapeId, 1) == 0)
+    {
+        return;
+    }
+
+    // Resting cows shoved into each other come apart at the contact pushout velocity
+    const RestState &rest = m_rest[cow];
+    b2Shape_SetFilter(shapeId, rest.filter);
+    b2Body_SetLinearDamping(bodyId, rest.linear_damping);
+    b2Body_SetAngularDamping(bodyId, rest.angular_damping);
+    b2Body_SetAwake(bodyId, true);
+}
+
+void Herd::FetchPoses()
+{
+    int count = GetActiveCount();
+    m_bodies.resize(count);
+    m_transforms.resize(count);
+    for (int slot = 0; slot < count; ++slot)
+    {
+        m_bodies[slot] = body_ids[m_active[slot]];
+    }
+    b2Body_GetTransforms(m_bodies.data(), m_transforms.data(), count);
+
+    // Routines deactivate cows and shuffle the slots, so the poses go by cow
+    for (int slot = 0; slot < count; ++slot)
+    {
+        poses[m_active[slot]] = m_transforms[slot];
+    }
+}
+
+void Herd::Steer()
+{
+    // A cow that started its activity after asking stays where it is
+    int count = 0;
+    for (int cow : m_steered)
+    {
+        if (states[cow] != cow_in_activity)
+        {
+            m_steered[count++] = cow;
+        }
+    }
+    m_steered.resize(count);
+    m_steering.Resize(count);
+
+    int total = count + int(m_stopped.size());
+    m_bodies.resize(total);
+    m_velocities.resize(total);
+    m_angularVelocities.resize(total);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Cow &cow = m_cows[m_steered[i]];
+        const b2Transform &transform = poses[m_steered[i]];
+        m_steering.position_x[i] = transform.p.x;
+        m_steering.position_y[i] = transform.p.y;
+        m_steering.rotation_c[i] = transform.q.c;
+        m_steering.rotation_s[i] = transform.q.s;
+        m_steering.waypoint_x[i] = cow.cow_var.waypoint.x;
+        m_steering.waypoint_y[i] = cow.cow_var.waypoint.y;
+    }
+
+    SteeringParams params;
+    params.speed_gain = cow_params.k_v;
+    params.max_speed = float(cow_max_speed);
+    params.max_steering = float(cow_max_steering_angle);
+    params.leg_base = float(cow_leg_base);
+    ::Steer(m_steering, params);
+
+    // One call for the steered cows and the ones standing still
+    for (int i = 0; i < count; ++i)
+    {
+        m_bodies[i] = body_ids[m_steered[i]];
+        m_velocities[i] = {m_steering.linear_x[i], m_steering.linear_y[i]};
+        m_angularVelocities[i] = m_steering.angular[i];
+    }
+    for (int i = count; i < total; ++i)
+    {
+        m_bodies[i] = body_ids[m_stopped[i - count]];
+        m_velocities[i] = b2Vec2_zero;
+        m_angularVelocities[i] = 0.0f;
+    }
+    b2Body_SetVelocities(m_bodies.data(), m_velocities.data(), m_angularVelocities.data(), total);
+    m_steered.clear();
+    m_stopped.clear();
+}
+
+int Herd::CountState(cow_states state) const
+{
+    int count = 0;
+    for (cow_states s : states)
+    {
+        count += s == state ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "cow.h"
+#include "steering_kernel.h"
+
+#include "box2d/id.h"
+#include "box2d/math_functions.h"
+#include "box2d/types.h"
+
+#include <vector>
+
+// The cows of the barn, sized to the herd that was spawned. What the owner touches
+// every step lives in parallel arrays indexed by cow, the paths, planner settings and
+// layout pointers stay in the Cow. Cows busy in an activity drop off the dense active
+// list, so a step only walks the cows that move or plan.
+class Herd
+{
+public:
+    Herd();
+
+    // Despawns the old herd and makes count unspawned cows, all on the active list
+    void Create(int count);
+    void Clear(); // despawns every cow and empties the herd
+
+    void Activate(int cow);   // Routine runs again from the next step
+    void Deactivate(int cow); // swaps the last active cow into the freed slot
+
+    // Busy cows stand still for the whole activity. Resting puts their bodies to sleep
+    // and Activate wakes them again, so the awake set holds the cows that move and the
+    // resting cows they push.
+    void SetRestBusyCows(bool flag);
+    bool GetRestBusyCows() const { return m_restBusyCows; }
+    float resting_damping = 10.0f; // a shoved resting cow stops within a second
+
+    int GetCount() const { return int(m_cows.size()); }
+    int GetActiveCount() const { return int(m_active.size()); }
+    int GetActive(int slot) const { return m_active[slot]; }
+    bool IsActive(int cow) const { return m_activeSlots[cow] >= 0; }
+    Cow &GetCow(int cow) { return m_cows[cow]; }
+    int CountState(cow_states state) const;
+
+    // One bulk read of the poses of the active cows, after the wakes and before the routines
+    void FetchPoses();
+    const b2Transform &GetPose(int cow) const { return poses[cow]; }
+
+    // Cows with cow_batched_steering ask during Routine, cows waiting for a plan ask to
+    // stand still. Steer runs the 8 wide controller over the poses of the first and sets
+    // the velocities of both in one call, so the owner calls it after every routine pass.
+    void RequestSteering(int cow) { m_steered.push_back(cow); }
+    void RequestStop(int cow) { m_stopped.push_back(cow); }
+    void Steer();
+    int GetSteeredCount() const { return m_steering.count; }
+
+    // Per cow, written through the Cow accessors
+    std::vector<b2BodyId> body_ids;
+    std::vector<cow_states> states;
+    std::vector<int> waypoint_indices; // into the cow_path of the cow
+    std::vector<b2Vec2> targets;
+    std::vector<int> idle_steps; // countdown after a failed plan
+    std::vector<b2Transform> poses; // of the active cows, as of the last FetchPoses
+
+    PlanStats plan_stats; // every plan the herd finished
+
+    enum
+    {
+        e_restingCategory = 0x0002, // shape category of resting cows, the barn uses the default
+    };
+
+private:
+    // What Wake puts back
+    struct RestState
+    {
+        b2Filter filter;
+        float linear_damping;
+        float angular_damping;
+    };
+
+    void Rest(int cow);
+    void Wake(int cow);
+
+    std::vector<Cow> m_cows;
+    std::vector<int> m_active;
+    std::vector<int> m_activeSlots; // -1 when off the active list
+    std::vector<RestState> m_rest;
+    bool m_restBusyCows = true;
+    std::vector<int> m_steered;
+    std::vector<int> m_stopped;
+    SteeringSoA m_steering;
+    std::vector<b2BodyId> m_bodies; // bulk body calls of FetchPoses and Steer
+    std::vector<b2Transform> m_transforms;
+    std::vector<b2Vec2> m_velocities;
+    std::vector<float> m_angularVelocities;
+};
+
+// The hot fields of a cow are its row of the herd arrays
+inline b2BodyId Cow::BodyId() const
+{
+    return cow_herd->body_ids[cow_index];
+}
+
+inline cow_states &Cow::State()
+{
+    return cow_herd->states[cow_index];
+}
+
+inline cow_states Cow::State() const
+{
+    return cow_herd->states[cow_index];
+}
+
+inline int &Cow::WaypointIndex()
+{
+    return cow_herd->waypoint_indices[cow_index];
+}
+
+inline int Cow::WaypointIndex() const
+{
+    return cow_herd->waypoint_indices[cow_index];
+}
+
+inline b2Vec2 &Cow::Target()
+{
+    return cow_herd->targets[cow_index];
+}
+
+inline b2Vec2 Cow::Target() const
+{
+    return cow_herd->targets[cow_index];
+}
+
+inline int &Cow::IdleSteps()
+{
+    return cow_herd->idle_steps[cow_index];
+}
@@ -0,0 +1,292 @@
+#include "hierarchical_planner.h"
+#include "path_smoothing.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <float.h>
+
+HierarchicalPlanner::HierarchicalPlanner()
+{
+    m_graph = nullptr;
+    m_grid = nullptr;
+    m_startCell = 0;
+    m_startChunk = 0;
+    m_goalNode = 0;
+    m_goalSearch = 0;
+    m_stamp = 0;
+}
+
+float HierarchicalPlanner::Heuristic(int cell) const
+{
+    if (cell == m_goalNode)
+    {
+        return 0.0f;
+    }
+
+    int width = m_grid->GetWidth();
+    float dist = FLT_MAX;
+    for (int goal : m_goalCells)
+    {
+        dist = b2MinFloat(dist, Octile(goal % width - cell % width, goal / width - cell / width));
+    }
+    return dist;
+}
+
+void HierarchicalPlanner::Prepare(int cell_count)
+{
+    if (cell_count > int(m_costs.size()))
+    {
+        m_costs.resize(cell_count);
+        m_parents.resize(cell_count);
+        m_seenStamps.resize(cell_count, m_stamp);
+        m_closedStamps.resize(cell_count, m_stamp);
+    }
+
+    // Bumping the stamp forgets the previous plan without touching the cells
+    ++m_stamp;
+    m_open.clear();
+}
+
+bool HierarchicalPlanner::Push(int cell, int parent, float g)
+{
+    if (m_closedStamps[cell] == m_stamp || (m_seenStamps[cell] == m_stamp && m_costs[cell] <= g))
+    {
+        return false;
+    }
+
+    m_costs[cell] = g;
+    m_parents[cell] = parent;
+    m_seenStamps[cell] = m_stamp;
+
+    m_open.push_back({g + Heuristic(cell), g, cell});
+    std::push_heap(m_open.begin(), m_open.end(),
+                   [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+    return true;
+}
+
+void HierarchicalPlanner::PushGoal(int cell, int search, float g)
+{
+    if (Push(m_goalNode, cell, g))
+    {
+        m_goalSearch = search;
+    }
+}
+
+int HierarchicalPlanner::GoalCell(int cell) const
+{
+    // The goal search parents lead from the cell back to the goal cell it was closest to
+    const ChunkSearch &search = m_goalSearches[m_goalSearch];
+    int local = m_graph->LocalCell(cell);
+    while (search.parents[local] >= 0)
+    {
+        local = search.parents[local];
+    }
+    return m_graph->GridCell(m_graph->ChunkOf(cell), local);
+}
+
+void HierarchicalPlanner::Expand(int cell, float g)
+{
+    // Any cell of a goal chunk, the start too, finishes through the search of that chunk
+    int chunkIndex = m_graph->ChunkOf(cell);
+    for (size_t i = 0; i < m_goalChunks.size(); ++i)
+    {
+        float cost = m_goalChunks[i] == chunkIndex ? m_goalSearches[i].costs[m_graph->LocalCell(cell)] : FLT_MAX;
+        if (cost < FLT_MAX)
+        {
+            PushGoal(cell, int(i), g + cost);
+        }
+    }
+
+    // Leaving the chunk may still be shorter, the search decides
+    if (cell == m_startCell)
+    {
+        const ChunkGraph::Chunk &chunk = m_graph->GetChunk(m_startChunk);
+        for (int node : chunk.cells)
+        {
+            float cost = m_startSearch.costs[m_graph->LocalCell(node)];
+            if (cost < FLT_MAX)
+            {
+                Push(node, cell, g + cost);
+            }
+        }
+    }
+
+    int slot = m_graph->GetSlot(cell);
+    if (slot < 0)
+    {
+        return;
+    }
+
+    const ChunkGraph::Chunk &chunk = m_graph->GetChunk(chunkIndex);
+    int count = int(chunk.cells.size());
+    for (int j = 0; j < count; ++j)
+    {
+        float cost = chunk.costs[slot * count + j];
+        if (j != slot && cost < FLT_MAX)
+        {
+            Push(chunk.cells[j], cell, g + cost);
+        }
+    }
+
+    for (const ChunkGraph::Link &link : chunk.links)
+    {
+        if (link.node == slot)
+        {
+            Push(link.partner, cell, g + 1.0f);
+        }
+    }
+}
+
+PlanResult HierarchicalPlanner::FindPath(b2Vec2 start, const std::vector<std::pair<int, int>> &goal_cells,
+                                         const ChunkGraph &graph, const PlanBudget &budget)
+{
+    PlanResult result;
+    const OccupancyGrid *grid = graph.GetGrid();
+    int startX, startY;
+    if (grid == nullptr || grid->GetCellCount() == 0 || !grid->FindFreeCell(start, &startX, &startY))
+    {
+        return result;
+    }
+
+    m_graph = &graph;
+    m_grid = grid;
+    m_startCell = startY * grid->GetWidth() + startX;
+    m_startChunk = graph.ChunkOf(m_startCell);
+    m_goalNode = grid->GetCellCount();
+
+    m_goalCells.clear();
+    m_goalChunks.clear();
+    for (const std::pair<int, int> &goal : goal_cells)
+    {
+        if (grid->IsInside(goal.first, goal.second) && !grid->IsBlocked(goal.first, goal.second))
+        {
+            int cell = goal.second * grid->GetWidth() + goal.first;
+            m_goalCells.push_back(cell);
+            if (std::find(m_goalChunks.begin(), m_goalChunks.end(), graph.ChunkOf(cell)) == m_goalChunks.end())
+            {
+                m_goalChunks.push_back(graph.ChunkOf(cell));
+            }
+        }
+    }
+    if (m_goalCells.empty())
+    {
+        return result;
+    }
+
+    // The query cells reach their chunk entrances through a search of that chunk only,
+    // one search from all the goal cells of a chunk at once
+    graph.SearchChunk(m_startCell, -1, m_startSearch);
+    if (m_goalSearches.size() < m_goalChunks.size())
+    {
+        m_goalSearches.resize(m_goalChunks.size());
+    }
+    for (size_t i = 0; i < m_goalChunks.size(); ++i)
+    {
+        m_chunkGoals.clear();
+        for (int cell : m_goalCells)
+        {
+            if (graph.ChunkOf(cell) == m_goalChunks[i])
+            {
+                m_chunkGoals.push_back(cell);
+            }
+        }
+        graph.SearchChunk(m_chunkGoals, m_goalSearches[i]);
+    }
+
+    Prepare(m_goalNode + 1);
+    Push(m_startCell, -1, 0.0f);
+
+    int closest = m_startCell;
+    float closestDist = Heuristic(m_startCell);
+    bool exhausted = true;
+
+    b2Timer timer = b2CreateTimer();
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(),
+                      [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+        OpenNode node = m_open.back();
+        m_open.pop_back();
+
+        if (m_closedStamps[node.cell] == m_stamp || node.g > m_costs[node.cell])
+        {
+            continue;
+        }
+        m_closedStamps[node.cell] = m_stamp;
+        ++result.iterations;
+
+        if (node.cell == m_goalNode)
+        {
+            result.status = plan_found;
+            BuildPath(node.cell, result.path);
+            return result;
+        }
+
+        float dist = node.f - node.g;
+        if (dist < closestDist)
+        {
+            closest = node.cell;
+            closestDist = dist;
+        }
+
+        Expand(node.cell, node.g);
+
+        // Each expansion walks a row of the chunk costs, check the clock a little more often than the grid planners
+        if (result.iterations >= budget.max_iterations ||
+            ((result.iterations & 15) == 0 && budget.max_milliseconds > 0.0f &&
+             b2GetMilliseconds(&timer) > budget.max_milliseconds))
+        {
+            exhausted = false;
+            break;
+        }
+    }
+
+    if (!exhausted && closest != m_startCell)
+    {
+        result.status = plan_partial;
+        BuildPath(closest, result.path);
+    }
+    return result;
+}
+
+void HierarchicalPlanner::BuildPath(int cell, std::vector<b2Vec2> &path)
+{
+    m_route.clear();
+    for (; cell >= 0; cell = m_parents[cell])
+    {
+        m_route.push_back(cell == m_goalNode ? GoalCell(m_parents[cell]) : cell);
+    }
+    std::reverse(m_route.begin(), m_route.end());
+
+    // Refine each abstract edge inside its chunk, steps across a border are already one cell
+    int width = m_grid->GetWidth();
+    path.clear();
+    path.push_back(m_grid->CellCenter(m_route[0] % width, m_route[0] / width));
+    for (size_t i = 1; i < m_route.size(); ++i)
+    {
+        int from = m_route[i - 1];
+        int to = m_route[i];
+        int chunk = m_graph->ChunkOf(to);
+        if (m_graph->ChunkOf(from) == chunk)
+        {
+            m_graph->SearchChunk(from, to, m_refineSearch);
+
+            size_t first = path.size();
+            for (int local = m_graph->LocalCell(to); m_refineSearch.parents[local] >= 0;
+                 local = m_refineSearch.parents[local])
+            {
+                int step = m_graph->GridCell(chunk, local);
+                path.push_back(m_grid->CellCenter(step % width, step / width));
+            }
+            std::reverse(path.begin() + first, path.end());
+        }
+        else
+        {
+            path.push_back(m_grid->CellCenter(to % width, to / width));
+        }
+    }
+
+    // The chunk searches store every cell of a straight run
+    RemoveCollinearPoints(path, 0.01f);
+}
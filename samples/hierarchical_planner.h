@@ -0,0 +1,65 @@
+#pragma once
+
+#include "chunk_graph.h"
+#include "planner.h"
+
+#include "box2d/types.h"
+
+#include <utility>
+#include <vector>
+
+// HPA* over a ChunkGraph. The start and the goal cells join the graph for one query
+// through a search of their own chunk, then A* with the octile heuristic runs over
+// the chunk entrances. The goal cells, the free sides of a functional area, feed one
+// virtual goal node, so the plan ends on whichever of them is closest. Only the chunks the route crosses are searched cell by cell, when the
+// abstract path is turned back into cell centres, so a long route costs about the
+// number of chunks it crosses instead of the number of cells.
+//
+// Paths keep to the entrances, a few percent longer than grid A*, and the cows
+// shortcut the rest on the way. Scratch arrays are stamped like GridPlanner.
+class HierarchicalPlanner
+{
+public:
+    HierarchicalPlanner();
+
+    PlanResult FindPath(b2Vec2 start, const std::vector<std::pair<int, int>> &goal_cells, const ChunkGraph &graph,
+                        const PlanBudget &budget);
+
+private:
+    struct OpenNode
+    {
+        float f;
+        float g;
+        int cell;
+    };
+
+    float Heuristic(int cell) const;
+    void Prepare(int cell_count);
+    bool Push(int cell, int parent, float g);
+    void PushGoal(int cell, int search, float g);
+    int GoalCell(int cell) const;
+    void Expand(int cell, float g);
+    void BuildPath(int cell, std::vector<b2Vec2> &path);
+
+    const ChunkGraph *m_graph;
+    const OccupancyGrid *m_grid;
+    int m_startCell;
+    int m_startChunk;
+    int m_goalNode;   // one past the grid cells
+    int m_goalSearch; // goal search the best push to the goal node came from
+    int m_stamp;
+
+    ChunkSearch m_startSearch; // costs from the start to the cells of its chunk
+    ChunkSearch m_refineSearch;
+    std::vector<int> m_goalCells;
+    std::vector<int> m_goalChunks;
+    std::vector<int> m_chunkGoals;
+    std::vector<ChunkSearch> m_goalSearches; // from the goal cells of each goal chunk, the moves are symmetric
+
+    std::vector<float> m_costs;   // indexed by grid cell, only the entrances and the query cells are used
+    std::vector<int> m_parents;
+    std::vector<int> m_seenStamps;
+    std::vector<int> m_closedStamps;
+    std::vector<OpenNode> m_open; // binary heap, stale entries are skipped on pop
+    std::vector<int> m_route;     // abstract path, start first
+};
@@ -1,11 +1,12 @@
 #include "mapmaker.h"
-#include "sample.h"
 
 #include "box2d/box2d.h"
 #include "box2d/math_functions.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
+#include <map>
 
 //
 
@@ -14,6 +15,7 @@ MapMaker::MapMaker()
     std::vector<SampleFunctionalArea> layout;
     std::vector<b2AABB> cow_map;
     std::vector<b2AABB> cow_aabbs;
+    clearance = 0.0f;
 }
 
 std::vector<std::vector<bool>> MapMaker::LayoutToGrid()
@@ -51,13 +53,158 @@ std::vector<std::vector<bool>> MapMaker::LayoutToGrid()
     return grid_map;
 }
 
+void MapMaker::CreateGridMap()
+{
+    grid_map = LayoutToGrid();
+    occupancy.Build(grid_map, 24.0f); // one bit per barn cell
+}
+
+void MapMaker::CreateActivitySampler()
+{
+    activities.Build(layout);
+}
+
+void MapMaker::CreateFlowFields()
+{
+    flow_fields.Reset(occupancy);
+    for (const SampleFunctionalArea &area : layout)
+    {
+        flow_fields.AddField(AreaCells(area));
+    }
+}
+
+void MapMaker::CreateChunkGraph()
+{
+    // 10 cells keep a chunk search to 100 cells, and the largest canvas to 100 chunks
+    chunk_graph.Build(occupancy, 10);
+}
+
+void MapMaker::CreateVisibilityGraph()
+{
+    // times 24 to fit the world, like the barn walls
+    visibility.Build(obstacle_index, b2Vec2{corner_layout.first * 24.0f, corner_layout.second * 24.0f});
+}
+
+int MapMaker::RepairVisibilityGraph()
+{
+    return visibility.Repair(obstacle_index, b2Vec2{corner_layout.first * 24.0f, corner_layout.second * 24.0f});
+}
+
+LayoutEdit MapMaker::EditLayout(const std::vector<SampleFunctionalArea> &new_layout)
+{
+    LayoutEdit edit;
+
+    // Areas that did not move keep their flow field, found by their anchor cell
+    std::multimap<std::pair<float, float>, int> oldAreas;
+    for (int i = 0; i < int(layout.size()); ++i)
+    {
+        oldAreas.insert({{layout[i].x, layout[i].y}, i});
+    }
+
+    edit.area_remap.assign(layout.size(), -1);
+    for (int j = 0; j < int(new_layout.size()); ++j)
+    {
+        auto range = oldAreas.equal_range({new_layout[j].x, new_layout[j].y});
+        auto match = range.first;
+        while (match != range.second && !SameArea(layout[match->second], new_layout[j]))
+        {
+            ++match;
+        }
+
+        if (match == range.second)
+        {
+            edit.added_areas.push_back(j);
+            continue;
+        }
+
+        edit.area_remap[match->second] = j;
+        oldAreas.erase(match);
+    }
+
+    layout = new_layout;
+    activities.Build(layout);
+    std::vector<std::vector<bool>> new_grid = LayoutToGrid();
+    for (int x = 0; x < int(new_grid.size()); ++x)
+    {
+        for (int y = 0; y < int(new_grid[x].size()); ++y)
+        {
+            if (new_grid[x][y] == grid_map[x][y])
+            {
+                continue;
+            }
+
+            occupancy.SetCell(x, y, new_grid[x][y]);
+            edit.changed_cells.push_back({x, y});
+            if (new_grid[x][y])
+            {
+                float size = occupancy.GetCellSize();
+                b2AABB box;
+                box.lowerBound = {x * size - clearance, y * size - clearance};
+                box.upperBound = {(x + 1) * size + clearance, (y + 1) * size + clearance};
+                edit.blocked_boxes.push_back(box);
+            }
+        }
+    }
+    grid_map.swap(new_grid);
+    edit.rebuilt_chunks = chunk_graph.RepairCells(edit.changed_cells);
+
+    // Drop the fields of removed areas before the repair, then build the new ones on the edited grid
+    flow_fields.RemapFields(edit.area_remap, int(layout.size()));
+    edit.repaired_cells = flow_fields.RepairFields(edit.changed_cells);
+    for (int area : edit.added_areas)
+    {
+        flow_fields.SetField(area, AreaCells(layout[area]));
+    }
+    return edit;
+}
+
+bool MapMaker::SameLayout(const std::vector<SampleFunctionalArea> &other) const
+{
+    if (other.size() != layout.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < layout.size(); ++i)
+    {
+        if (!SameArea(layout[i], other[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MapMaker::SameArea(const SampleFunctionalArea &a, const SampleFunctionalArea &b)
+{
+    return a.type == b.type && a.orientation == b.orientation && a.x == b.x && a.y == b.y;
+}
+
 std::pair<int, int> MapMaker::WorldToGrid(const b2Vec2 point)
 {
-    int x = static_cast<int>(point.x / corner_layout.first);
-    int y = static_cast<int>(point.y / corner_layout.second);
+    // divided by 24 to go from the world to the barn cells
+    int x = static_cast<int>(point.x / 24.0f);
+    int y = static_cast<int>(point.y / 24.0f);
     return {x, y};
 }
 
+b2Vec2 MapMaker::AreaCenter(const SampleFunctionalArea &area)
+{
+    // from grid to world, two cell areas are centred on their shared edge
+    b2Vec2 center = {area.x * 24.0f + 12.0f, area.y * 24.0f + 12.0f};
+    if (area.orientation == 1) // vertical
+        center.y += 12.0f;
+    if (area.orientation == 2) // horizontal
+        center.x += 12.0f;
+    return center;
+}
+
+b2AABB MapMaker::AreaAABB(const SampleFunctionalArea &area)
+{
+    b2Vec2 center = AreaCenter(area);
+    return ConvertToABB(center.x, center.y, area.orientation);
+}
+
 b2AABB MapMaker::ConvertToABB(float x, float y, int orientation)
 {
     b2Vec2 lower_bound, upper_bound;
@@ -161,10 +308,34 @@ void MapMaker::CreateCowMap()
     //     std::cout << rec.lowerBound.x << "|" << rec.lowerBound.y << "|" << rec.upperBound.x << "|" << rec.upperBound.y << std::endl;
     // }
     cow_map = mergedAABBs;
+    InflateCowMap();
+}
+
+void MapMaker::InflateCowMap()
+{
+    // Minkowski sum with the cow, so the planner can treat the cow as a point
+    inflated_map.clear();
+    for (const b2AABB &aabb : cow_map)
+    {
+        b2AABB inflated;
+        inflated.lowerBound = {aabb.lowerBound.x - clearance, aabb.lowerBound.y - clearance};
+        inflated.upperBound = {aabb.upperBound.x + clearance, aabb.upperBound.y + clearance};
+        inflated_map.push_back(inflated);
+    }
+
+    obstacle_index.Build(inflated_map);
 }
 
 void MapMaker::DestroyMaps()
 {
     cow_aabbs.clear();
     cow_map.clear();
+    inflated_map.clear();
+    visibility.Clear();
+    obstacle_index.Clear();
+    grid_map.clear();
+    flow_fields.Clear();
+    activities.Clear();
+    chunk_graph.Clear();
+    occupancy.Clear();
 }
@@ -1,5 +1,11 @@
 #pragma once
-#include "sample.h"
+#include "activity_sampler.h"
+#include "barn_layout.h"
+#include "chunk_graph.h"
+#include "flow_field.h"
+#include "obstacle_index.h"
+#include "occupancy_grid.h"
+#include "visibility_graph.h"
 
 #include "box2d/types.h"
 
@@ -7,6 +13,17 @@
 
 const std::vector<b2Vec2> orient_map_arr = {{12.0f, 12.0f}, {12.0f, 24.0f}, {24.0f, 12.0f}}; //
 
+// What MapMaker::EditLayout changed
+struct LayoutEdit
+{
+    std::vector<int> area_remap;                    // old layout index to new, -1 for removed areas
+    std::vector<int> added_areas;                   // new layout indices without an old match
+    std::vector<std::pair<int, int>> changed_cells; // grid cells that flipped
+    std::vector<b2AABB> blocked_boxes;              // world boxes of the newly blocked cells, grown by clearance
+    int repaired_cells = 0;                         // flow field cells the repair touched
+    int rebuilt_chunks = 0;                         // chunk graph chunks redone
+};
+
 class MapMaker
 {
 public:
@@ -14,18 +31,42 @@ public:
 
     std::vector<SampleFunctionalArea> layout;
     std::pair<int, int> corner_layout;
+    ActivitySampler activities; // transition tables conditioned on the area types of layout
     std::vector<std::vector<bool>> grid_map;
+    OccupancyGrid occupancy; // packed grid_map for the grid planners
+    FlowFields flow_fields;  // one field per layout entry, same index
+    ChunkGraph chunk_graph;  // entrances between grid chunks, for the hierarchical engine
 
     std::vector<b2AABB> cow_map;
     std::vector<b2AABB> cow_aabbs;
+    std::vector<b2AABB> inflated_map; // cow_map grown by clearance on every side
+    ObstacleIndex obstacle_index;     // built from inflated_map, shared with the cows
+    VisibilityGraph visibility;       // corners of inflated_map, for the visibility engine
+    float clearance;                  // cow half width plus margin, under half a cell
     b2Vec2 max_map_area;
 
     std::vector<std::vector<bool>> LayoutToGrid();
+    void CreateGridMap(); // needs layout and corner_layout
+    void CreateActivitySampler(); // needs layout
+    void CreateFlowFields(); // needs the grid map
+    void CreateChunkGraph(); // needs the grid map
+    void CreateVisibilityGraph(); // needs the cow map and corner_layout
+    int RepairVisibilityGraph(); // after EditLayout and the new cow map, returns the corners the edit made
     std::pair<int, int> WorldToGrid(b2Vec2 point);
 
+    // Patches the grid map, the occupancy grid, the chunk graph and the flow fields in place
+    // for a layout of the same size, and rebuilds the activity sampler. The caller respawns
+    // the areas and rebuilds the cow map.
+    LayoutEdit EditLayout(const std::vector<SampleFunctionalArea> &new_layout);
+    bool SameLayout(const std::vector<SampleFunctionalArea> &other) const;
+    static bool SameArea(const SampleFunctionalArea &a, const SampleFunctionalArea &b);
+
     b2AABB ConvertToABB(float x, float y, int orientation);
+    static b2Vec2 AreaCenter(const SampleFunctionalArea &area); // world centre of the footprint
+    b2AABB AreaAABB(const SampleFunctionalArea &area);
     bool CanMerge(const b2AABB &a, const b2AABB &b);
     b2AABB Merge(const b2AABB &a, const b2AABB &b);
     void CreateCowMap();
+    void InflateCowMap();
     void DestroyMaps();
 };
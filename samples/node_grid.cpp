@@ -0,0 +1,154 @@
+#include "node_grid.h"
+#include "rrt.h"
+
+#include "box2d/math_functions.h"
+
+#include <assert.h>
+#include <limits>
+
+NodeGrid::NodeGrid()
+{
+    m_cellSize = 24.0f;
+    m_invCellSize = 1.0f / m_cellSize;
+    m_columns = 0;
+    m_rows = 0;
+    m_stamp = 0;
+}
+
+void NodeGrid::Reset(b2Vec2 area, float cell_size)
+{
+    assert(cell_size > 0.0f);
+    m_cellSize = cell_size;
+    m_invCellSize = 1.0f / cell_size;
+
+    int columns = b2MaxInt(1, int(area.x * m_invCellSize) + 1);
+    int rows = b2MaxInt(1, int(area.y * m_invCellSize) + 1);
+    if (columns * rows > int(m_heads.size()))
+    {
+        m_heads.resize(columns * rows);
+        m_headStamps.resize(columns * rows, m_stamp);
+    }
+    m_columns = columns;
+    m_rows = rows;
+
+    // Bumping the stamp invalidates every head without touching the cells
+    ++m_stamp;
+    m_items.clear();
+    m_next.clear();
+}
+
+int NodeGrid::ClampColumn(float x) const
+{
+    return b2ClampInt(int(x * m_invCellSize), 0, m_columns - 1);
+}
+
+int NodeGrid::ClampRow(float y) const
+{
+    return b2ClampInt(int(y * m_invCellSize), 0, m_rows - 1);
+}
+
+void NodeGrid::Insert(Node *node)
+{
+    int cell = CellIndex(ClampColumn(node->position.x), ClampRow(node->position.y));
+    int head = m_headStamps[cell] == m_stamp ? m_heads[cell] : -1;
+
+    m_next.push_back(head);
+    m_items.push_back(node);
+    m_heads[cell] = int(m_items.size()) - 1;
+    m_headStamps[cell] = m_stamp;
+}
+
+Node *NodeGrid::FindNearest(b2Vec2 point, int *nodes_visited) const
+{
+    Node *nearest = nullptr;
+    float minDist = std::numeric_limits<float>::max();
+    int visited = 0;
+
+    int cx = ClampColumn(point.x);
+    int cy = ClampRow(point.y);
+    int maxRing = b2MaxInt(b2MaxInt(cx, m_columns - 1 - cx), b2MaxInt(cy, m_rows - 1 - cy));
+
+    // A query outside the grid is clamped to a border cell, shrink the ring bound by the overshoot
+    float overshootX = b2MaxFloat(0.0f, b2MaxFloat(cx * m_cellSize - point.x, point.x - (cx + 1) * m_cellSize));
+    float overshootY = b2MaxFloat(0.0f, b2MaxFloat(cy * m_cellSize - point.y, point.y - (cy + 1) * m_cellSize));
+    float overshoot = overshootX + overshootY;
+
+    for (int ring = 0; ring <= maxRing; ++ring)
+    {
+        int x0 = cx - ring, x1 = cx + ring;
+        int y0 = cy - ring, y1 = cy + ring;
+        for (int y = b2MaxInt(y0, 0); y <= b2MinInt(y1, m_rows - 1); ++y)
+        {
+            // Interior rows of the ring only have the two side cells
+            bool edgeRow = (y == y0 || y == y1);
+            int step = edgeRow ? 1 : b2MaxInt(x1 - x0, 1);
+            for (int x = x0; x <= x1; x += step)
+            {
+                if (x < 0 || x >= m_columns)
+                {
+                    continue;
+                }
+
+                int cell = CellIndex(x, y);
+                if (m_headStamps[cell] != m_stamp)
+                {
+                    continue;
+                }
+
+                for (int item = m_heads[cell]; item != -1; item = m_next[item])
+                {
+                    ++visited;
+                    float dist = b2DistanceSquared(point, m_items[item]->position);
+                    if (dist < minDist)
+                    {
+                        nearest = m_items[item];
+                        minDist = dist;
+                    }
+                }
+            }
+        }
+
+        // Nodes outside this ring are at least ring * cell size away
+        float reach = ring * m_cellSize - overshoot;
+        if (nearest != nullptr && reach > 0.0f && minDist <= reach * reach)
+        {
+            break;
+        }
+    }
+
+    if (nodes_visited != nullptr)
+    {
+        *nodes_visited = visited;
+    }
+    return nearest;
+}
+
+int NodeGrid::FindNear(b2Vec2 point, float radius, std::vector<Node *> *near) const
+{
+    int x0 = ClampColumn(point.x - radius), x1 = ClampColumn(point.x + radius);
+    int y0 = ClampRow(point.y - radius), y1 = ClampRow(point.y + radius);
+    float radiusSqr = radius * radius;
+    int visited = 0;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            int cell = CellIndex(x, y);
+            if (m_headStamps[cell] != m_stamp)
+            {
+                continue;
+            }
+
+            for (int item = m_heads[cell]; item != -1; item = m_next[item])
+            {
+                ++visited;
+                if (b2DistanceSquared(point, m_items[item]->position) <= radiusSqr)
+                {
+                    near->push_back(m_items[item]);
+                }
+            }
+        }
+    }
+    return visited;
+}
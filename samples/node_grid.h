@@ -0,0 +1,39 @@
+#pragma once
+
+#include "box2d/types.h"
+
+#include <vector>
+
+struct Node;
+
+// Uniform grid over the RRT nodes, aligned to the 24 unit barn cell. Nodes are
+// inserted as the tree grows and the nearest node is found by searching rings of
+// cells around the query point.
+class NodeGrid
+{
+public:
+    NodeGrid();
+
+    void Reset(b2Vec2 area, float cell_size); // O(1) for the cells, uses stamps
+    void Insert(Node *node);
+    Node *FindNearest(b2Vec2 point, int *nodes_visited) const;
+
+    // Appends the nodes within radius of the point to near, returns the nodes visited
+    int FindNear(b2Vec2 point, float radius, std::vector<Node *> *near) const;
+
+private:
+    int CellIndex(int x, int y) const { return y * m_columns + x; }
+    int ClampColumn(float x) const;
+    int ClampRow(float y) const;
+
+    float m_cellSize;
+    float m_invCellSize;
+    int m_columns;
+    int m_rows;
+    int m_stamp;
+
+    std::vector<int> m_heads;      // first item of each cell, valid if the stamp matches
+    std::vector<int> m_headStamps; // stamp of the plan that wrote the head
+    std::vector<Node *> m_items;
+    std::vector<int> m_next; // next item in the same cell
+};
@@ -0,0 +1,133 @@
+#include "obstacle_index.h"
+
+#include "box2d/math_functions.h"
+
+#include <float.h>
+
+ObstacleIndex::ObstacleIndex()
+{
+    m_tree = b2DynamicTree_Create();
+}
+
+ObstacleIndex::~ObstacleIndex()
+{
+    b2DynamicTree_Destroy(&m_tree);
+}
+
+void ObstacleIndex::Build(const std::vector<b2AABB> &obstacles)
+{
+    Clear();
+
+    m_obstacles = obstacles;
+    m_bounds.Assign(m_obstacles);
+    for (int i = 0; i < int(m_obstacles.size()); ++i)
+    {
+        b2DynamicTree_CreateProxy(&m_tree, m_obstacles[i], b2_defaultCategoryBits, i);
+    }
+
+    // The layout does not move, so pay for a good tree once
+    b2DynamicTree_Rebuild(&m_tree, true);
+}
+
+void ObstacleIndex::Clear()
+{
+    b2DynamicTree_Destroy(&m_tree);
+    m_tree = b2DynamicTree_Create();
+    m_obstacles.clear();
+    m_bounds.Clear();
+}
+
+// Candidates from the tree are packed into blocks of 8 for the kernels
+struct GatherContext
+{
+    const std::vector<b2AABB> *obstacles;
+    SegmentQuery segment;
+    bool blocked;
+    int count;
+    float lower_x[AABBSoA::e_blockSize];
+    float lower_y[AABBSoA::e_blockSize];
+    float upper_x[AABBSoA::e_blockSize];
+    float upper_y[AABBSoA::e_blockSize];
+
+    void Flush()
+    {
+        for (int i = count; i < AABBSoA::e_blockSize; ++i)
+        {
+            lower_x[i] = FLT_MAX;
+            lower_y[i] = FLT_MAX;
+            upper_x[i] = -FLT_MAX;
+            upper_y[i] = -FLT_MAX;
+        }
+
+        blocked = blocked || SegmentHits(segment, lower_x, lower_y, upper_x, upper_y, AABBSoA::e_blockSize);
+        count = 0;
+    }
+};
+
+static bool GatherCallback(int32_t proxyId, int32_t userData, void *context)
+{
+    (void)proxyId;
+    GatherContext *gather = static_cast<GatherContext *>(context);
+    const b2AABB &aabb = (*gather->obstacles)[userData];
+    gather->lower_x[gather->count] = aabb.lowerBound.x;
+    gather->lower_y[gather->count] = aabb.lowerBound.y;
+    gather->upper_x[gather->count] = aabb.upperBound.x;
+    gather->upper_y[gather->count] = aabb.upperBound.y;
+    gather->count += 1;
+
+    if (gather->count == AABBSoA::e_blockSize)
+    {
+        gather->Flush();
+    }
+
+    // stop the query on the first hit
+    return gather->blocked == false;
+}
+
+bool ObstacleIndex::SegmentBlocked(b2Vec2 from, b2Vec2 to) const
+{
+    SegmentQuery segment = MakeSegmentQuery(from, to);
+    if (GetCount() <= brute_force_limit)
+    {
+        return SegmentHits(segment, m_bounds.lower_x.data(), m_bounds.lower_y.data(), m_bounds.upper_x.data(),
+                           m_bounds.upper_y.data(), m_bounds.padded_count);
+    }
+
+    GatherContext context;
+    context.obstacles = &m_obstacles;
+    context.segment = segment;
+    context.blocked = false;
+    context.count = 0;
+
+    b2AABB bounds = {b2Min(from, to), b2Max(from, to)};
+    b2DynamicTree_Query(&m_tree, bounds, b2_defaultMaskBits, GatherCallback, &context);
+    if (context.blocked == false && context.count > 0)
+    {
+        context.Flush();
+    }
+    return context.blocked;
+}
+
+static bool PointQueryCallback(int32_t proxyId, int32_t userData, void *context)
+{
+    (void)proxyId;
+    (void)userData;
+    bool *blocked = static_cast<bool *>(context);
+    *blocked = true;
+    return false;
+}
+
+bool ObstacleIndex::PointBlocked(b2Vec2 point, float inflate) const
+{
+    b2Vec2 extent = {inflate, inflate};
+    b2AABB bounds = {b2Sub(point, extent), b2Add(point, extent)};
+    if (GetCount() <= brute_force_limit)
+    {
+        return BoxOverlaps(bounds, m_bounds.lower_x.data(), m_bounds.lower_y.data(), m_bounds.upper_x.data(),
+                           m_bounds.upper_y.data(), m_bounds.padded_count);
+    }
+
+    bool blocked = false;
+    b2DynamicTree_Query(&m_tree, bounds, b2_defaultMaskBits, PointQueryCallback, &blocked);
+    return blocked;
+}
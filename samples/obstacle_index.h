@@ -0,0 +1,43 @@
+#pragma once
+
+#include "segment_kernel.h"
+
+#include "box2d/collision.h"
+#include "box2d/types.h"
+
+#include <vector>
+
+// Read-only view of the barn obstacles, built once per layout by MapMaker and
+// shared by pointer with every cow and planner. Small layouts are tested with
+// the SIMD kernels over all boxes, larger ones first gather nearby boxes from a
+// b2DynamicTree and run the kernels on those.
+class ObstacleIndex
+{
+public:
+    ObstacleIndex();
+    ~ObstacleIndex();
+
+    ObstacleIndex(const ObstacleIndex &) = delete;
+    ObstacleIndex &operator=(const ObstacleIndex &) = delete;
+
+    void Build(const std::vector<b2AABB> &obstacles);
+    void Clear();
+
+    // True if the segment from -> to hits an obstacle
+    bool SegmentBlocked(b2Vec2 from, b2Vec2 to) const;
+
+    // True if the point is within inflate of an obstacle
+    bool PointBlocked(b2Vec2 point, float inflate) const;
+
+    int GetCount() const { return int(m_obstacles.size()); }
+    const std::vector<b2AABB> &GetObstacles() const { return m_obstacles; }
+    const AABBSoA &GetBounds() const { return m_bounds; }
+
+    // Layouts up to this size skip the tree
+    int brute_force_limit = 64;
+
+private:
+    b2DynamicTree m_tree;
+    std::vector<b2AABB> m_obstacles;
+    AABBSoA m_bounds;
+};
@@ -0,0 +1,156 @@
+#include "occupancy_grid.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+
+namespace
+{
+// The four sides of a cell, diagonal neighbours do not count as beside it
+const int k_sideX[4] = {1, 0, -1, 0};
+const int k_sideY[4] = {0, 1, 0, -1};
+} // namespace
+
+OccupancyGrid::OccupancyGrid()
+{
+    m_width = 0;
+    m_height = 0;
+    m_stride = 2;
+    m_cellSize = 24.0f;
+    m_version = 0;
+    m_bits.assign(1, ~uint64_t(0)); // the lone border cells of an empty grid
+}
+
+void OccupancyGrid::Build(const std::vector<std::vector<bool>> &grid_map, float cell_size)
+{
+    m_width = int(grid_map.size());
+    m_height = m_width > 0 ? int(grid_map[0].size()) : 0;
+    m_stride = m_width + 2;
+    m_cellSize = cell_size;
+    m_version += 1;
+
+    int bitCount = m_stride * (m_height + 2);
+    m_bits.assign((bitCount + 63) / 64, 0);
+
+    for (int x = -1; x <= m_width; ++x)
+    {
+        SetBlocked(x, -1);
+        SetBlocked(x, m_height);
+    }
+    for (int y = 0; y < m_height; ++y)
+    {
+        SetBlocked(-1, y);
+        SetBlocked(m_width, y);
+    }
+
+    for (int x = 0; x < m_width; ++x)
+    {
+        for (int y = 0; y < m_height; ++y)
+        {
+            if (grid_map[x][y])
+            {
+                SetBlocked(x, y);
+            }
+        }
+    }
+}
+
+void OccupancyGrid::Clear()
+{
+    std::vector<std::vector<bool>> empty;
+    Build(empty, m_cellSize);
+}
+
+void OccupancyGrid::SetBlocked(int x, int y)
+{
+    int bit = (y + 1) * m_stride + x + 1;
+    m_bits[bit >> 6] |= uint64_t(1) << (bit & 63);
+}
+
+bool OccupancyGrid::SetCell(int x, int y, bool blocked)
+{
+    assert(IsInside(x, y));
+    if (IsBlocked(x, y) == blocked)
+    {
+        return false;
+    }
+
+    int bit = (y + 1) * m_stride + x + 1;
+    m_bits[bit >> 6] ^= uint64_t(1) << (bit & 63);
+    return true;
+}
+
+void OccupancyGrid::WorldToCell(b2Vec2 point, int *x, int *y) const
+{
+    *x = b2ClampInt(int(point.x / m_cellSize), 0, b2MaxInt(m_width - 1, 0));
+    *y = b2ClampInt(int(point.y / m_cellSize), 0, b2MaxInt(m_height - 1, 0));
+}
+
+b2Vec2 OccupancyGrid::CellCenter(int x, int y) const
+{
+    return {(x + 0.5f) * m_cellSize, (y + 0.5f) * m_cellSize};
+}
+
+bool OccupancyGrid::FindFreeCell(b2Vec2 point, int *x, int *y) const
+{
+    int cx, cy;
+    WorldToCell(point, &cx, &cy);
+    if (IsInside(cx, cy) && !IsBlocked(cx, cy))
+    {
+        *x = cx;
+        *y = cy;
+        return true;
+    }
+
+    int maxRadius = b2MaxInt(m_width, m_height);
+    for (int radius = 1; radius <= maxRadius; ++radius)
+    {
+        float bestDist = FLT_MAX;
+        for (int j = cy - radius; j <= cy + radius; ++j)
+        {
+            // Full rows at the top and bottom of the ring, only the ends in between
+            int step = (j == cy - radius || j == cy + radius) ? 1 : 2 * radius;
+            for (int i = cx - radius; i <= cx + radius; i += step)
+            {
+                if (!IsInside(i, j) || IsBlocked(i, j))
+                {
+                    continue;
+                }
+
+                float dist = b2DistanceSquared(point, CellCenter(i, j));
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    *x = i;
+                    *y = j;
+                }
+            }
+        }
+
+        if (bestDist < FLT_MAX)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OccupancyGrid::FindSideCells(const std::vector<std::pair<int, int>> &cells,
+                                  std::vector<std::pair<int, int>> &sides) const
+{
+    sides.clear();
+    for (const std::pair<int, int> &cell : cells)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            std::pair<int, int> side = {cell.first + k_sideX[i], cell.second + k_sideY[i]};
+            if (IsInside(side.first, side.second) && !IsBlocked(side.first, side.second) &&
+                std::find(sides.begin(), sides.end(), side) == sides.end())
+            {
+                sides.push_back(side);
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "box2d/types.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Bit packed copy of MapMaker::grid_map, one bit per 24 unit barn cell. The grid
+// is surrounded by a ring of blocked cells so the grid planners can step one
+// cell past the edge without range checks.
+class OccupancyGrid
+{
+public:
+    OccupancyGrid();
+
+    void Build(const std::vector<std::vector<bool>> &grid_map, float cell_size); // grid_map[x][y]
+    void Clear();
+
+    // x and y may be one cell outside the grid, those cells are blocked
+    bool IsBlocked(int x, int y) const
+    {
+        int bit = (y + 1) * m_stride + x + 1;
+        return (m_bits[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    bool IsInside(int x, int y) const { return 0 <= x && x < m_width && 0 <= y && y < m_height; }
+
+    // Cell under the point, clamped to the grid
+    void WorldToCell(b2Vec2 point, int *x, int *y) const;
+    b2Vec2 CellCenter(int x, int y) const;
+
+    // Closest free cell to the point searching rings around (x, y), false if the grid is full
+    bool FindFreeCell(b2Vec2 point, int *x, int *y) const;
+
+    // Free cells beside a blocked footprint, the cells FlowFields::SetField seeds an area from
+    void FindSideCells(const std::vector<std::pair<int, int>> &cells, std::vector<std::pair<int, int>> &sides) const;
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetCellCount() const { return m_width * m_height; }
+    float GetCellSize() const { return m_cellSize; }
+
+    // Flips one cell in place for a layout edit, false if it already had that value.
+    // Keeps the version, the caller repairs whatever depended on the cell.
+    bool SetCell(int x, int y, bool blocked);
+
+    // Bumped on every build so cached plans can tell the layout changed
+    int GetVersion() const { return m_version; }
+
+private:
+    void SetBlocked(int x, int y);
+
+    int m_width;
+    int m_height;
+    int m_stride; // bits per padded row
+    float m_cellSize;
+    int m_version;
+    std::vector<uint64_t> m_bits;
+};
@@ -0,0 +1,179 @@
+#include "path_refiner.h"
+
+#include "box2d/box2d.h"
+
+#include <assert.h>
+
+PathRefiner::PathRefiner()
+{
+    m_Priority = enki::TASK_PRIORITY_LOW;
+    m_MinRange = 1;
+    m_inFlight = false;
+}
+
+void PathRefiner::ExecuteRange(enki::TaskSetPartition range, uint32_t threadIndex)
+{
+    for (uint32_t i = range.start; i < range.end; ++i)
+    {
+        Slot &slot = m_slots[m_busy[i]];
+        PlanBudget budget = m_slice;
+        budget.max_iterations = b2MinInt(m_slice.max_iterations, max_iterations - slot.iterations);
+
+        float oldLength = slot.path.empty() ? 0.0f : PathLength(slot.path);
+        PlanResult result = slot.rrt.RefineStar(budget);
+        slot.iterations += result.iterations;
+        if (result.status == plan_found && (slot.path.empty() || PathLength(result.path) < oldLength))
+        {
+            slot.path.swap(result.path);
+            slot.improved = true;
+        }
+    }
+}
+
+void PathRefiner::Track(Cow *cow)
+{
+    m_queue.push_back({cow, cow->plan_count});
+}
+
+bool PathRefiner::IsCurrent(const Slot &slot) const
+{
+    const Cow *cow = slot.cow;
+    return cow->m_isSpawned && cow->plan_count == slot.plan_count && cow->State() == cow_traslating &&
+           !cow->cow_var.following_field && slot.iterations < max_iterations;
+}
+
+void PathRefiner::Start(Slot &slot, Cow *cow)
+{
+    // Same settings and stream as the first plan, so the tree grows along the same path
+    slot.cow = cow;
+    slot.plan_count = cow->plan_count;
+    slot.iterations = 0;
+    slot.improved = false;
+    slot.path.clear();
+
+    RRT &rrt = slot.rrt;
+    rrt.mode = rrt_star;
+    rrt.goal_bias = cow->goal_bias;
+    rrt.use_node_grid = cow->use_node_grid;
+    rrt.brute_force_limit = cow->brute_force_limit;
+    rrt.smooth_paths = cow->smooth_paths;
+    rrt.random.Seed(MixSeed(cow->cow_seed, cow->plan_count - 1));
+    rrt.Begin(cow->cow_var.start, cow->Target(), cow->cow_map, cow->max_b_area, 24.0f, 56.0f);
+}
+
+void PathRefiner::Submit(enki::TaskScheduler *scheduler, const PlanBudget &slice)
+{
+    assert(m_inFlight == false);
+
+    // Newest requests first, a cow that replanned since it was queued is skipped
+    int free = 0;
+    for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+    {
+        Cow *cow = it->first;
+        if (cow->plan_count != it->second)
+        {
+            continue;
+        }
+
+        while (free < e_slotCount && m_slots[free].cow != nullptr)
+        {
+            ++free;
+        }
+        if (free == e_slotCount)
+        {
+            break;
+        }
+
+        Start(m_slots[free], cow);
+    }
+    m_queue.clear();
+
+    m_busy.clear();
+    for (int i = 0; i < e_slotCount; ++i)
+    {
+        if (m_slots[i].cow != nullptr)
+        {
+            m_busy.push_back(i);
+        }
+    }
+
+    if (m_busy.empty() || slice.max_iterations <= 0)
+    {
+        return;
+    }
+
+    m_slice = slice;
+    m_SetSize = uint32_t(m_busy.size());
+    m_inFlight = true;
+    m_stats.slices += m_busy.size();
+    scheduler->AddTaskSetToPipe(this);
+}
+
+bool PathRefiner::Harvest()
+{
+    if (m_inFlight && GetIsComplete() == false)
+    {
+        return false;
+    }
+    m_inFlight = false;
+
+    for (int index : m_busy)
+    {
+        Slot &slot = m_slots[index];
+        if (slot.cow == nullptr)
+        {
+            continue;
+        }
+
+        if (slot.improved && slot.cow->plan_count == slot.plan_count)
+        {
+            // The cow takes the vector, the slot keeps its own copy to compare against
+            std::vector<b2Vec2> path = slot.path;
+            float before = slot.cow->cow_path.empty() ? 0.0f : PathLength(slot.cow->cow_path);
+            if (slot.cow->AdoptRefinedPath(path))
+            {
+                m_stats.improvements += 1;
+                m_stats.length_saved += b2MaxFloat(0.0f, before - PathLength(slot.cow->cow_path));
+            }
+        }
+        slot.improved = false;
+
+        if (!IsCurrent(slot))
+        {
+            m_stats.iterations += slot.iterations;
+            slot.cow = nullptr;
+        }
+    }
+    m_busy.clear();
+    return true;
+}
+
+void PathRefiner::Wait(enki::TaskScheduler *scheduler)
+{
+    if (m_inFlight)
+    {
+        scheduler->WaitforTask(this);
+    }
+    Harvest();
+}
+
+void PathRefiner::Clear()
+{
+    assert(m_inFlight == false);
+    for (Slot &slot : m_slots)
+    {
+        slot.cow = nullptr;
+    }
+    m_busy.clear();
+    m_queue.clear();
+}
+
+int PathRefiner::GetBusyCount() const
+{
+    int count = 0;
+    for (const Slot &slot : m_slots)
+    {
+        count += slot.cow != nullptr ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "herd.h"
+#include "rrt.h"
+
+#include "TaskScheduler.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct RefineStats
+{
+    long long slices = 0;
+    long long iterations = 0;
+    long long improvements = 0; // shorter paths the cows took
+    double length_saved = 0.0;  // walk shortened by those paths
+};
+
+// Anytime RRT* for cows walking a first rrt_star path. Each slot regrows the seeded
+// tree of one plan, so it replays the first path, and keeps growing it for a slice of
+// the step on the sample scheduler. Low priority like the plan batch. Shorter paths
+// are handed to the cows on the calling thread between steps, a cow never sees a
+// path that is still being written.
+class PathRefiner : public enki::ITaskSet
+{
+public:
+    PathRefiner();
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadIndex) override;
+
+    void Track(Cow *cow); // queues the current plan of the cow, picked up by the next Submit
+    // One slice for every busy slot. A slice with max_milliseconds <= 0 stops on its
+    // iterations only, so the refined paths do not depend on the machine.
+    void Submit(enki::TaskScheduler *scheduler, const PlanBudget &slice);
+    bool Harvest(); // hands shorter paths to the cows, false while the slices run
+    void Wait(enki::TaskScheduler *scheduler);
+    void Clear(); // drops every slot, for when the cows or the map go away
+
+    bool IsInFlight() const { return m_inFlight; }
+    int GetBusyCount() const;
+    const RefineStats &GetStats() const { return m_stats; }
+
+    int max_iterations = 5000; // a slot retires after growing this many nodes
+
+private:
+    enum
+    {
+        e_slotCount = 32,
+    };
+
+    struct Slot
+    {
+        Cow *cow = nullptr; // nullptr when free
+        uint32_t plan_count = 0; // the plan being refined, a newer plan retires the slot
+        RRT rrt;
+        int iterations = 0;
+        bool improved = false;
+        std::vector<b2Vec2> path;
+    };
+
+    bool IsCurrent(const Slot &slot) const;
+    void Start(Slot &slot, Cow *cow);
+
+    Slot m_slots[e_slotCount];
+    std::vector<int> m_busy; // slots in the running slice
+    std::vector<std::pair<Cow *, uint32_t>> m_queue;
+    PlanBudget m_slice;
+    bool m_inFlight;
+    RefineStats m_stats;
+};
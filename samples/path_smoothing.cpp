@@ -0,0 +1,64 @@
+#include "path_smoothing.h"
+#include "obstacle_index.h"
+
+#include "box2d/math_functions.h"
+
+void ShortcutPath(std::vector<b2Vec2> &path, const ObstacleIndex &obstacles)
+{
+    int count = int(path.size());
+    if (count < 3)
+    {
+        return;
+    }
+
+    int kept = 1;
+    int anchor = 0;
+    while (anchor < count - 1)
+    {
+        // Walk forward while the anchor still sees the next vertex
+        int reach = anchor + 1;
+        while (reach + 1 < count && obstacles.SegmentBlocked(path[anchor], path[reach + 1]) == false)
+        {
+            ++reach;
+        }
+
+        // kept never passes reach, so the write does not clobber unread vertices
+        path[kept++] = path[reach];
+        anchor = reach;
+    }
+
+    path.resize(kept);
+}
+
+void RemoveCollinearPoints(std::vector<b2Vec2> &path, float tolerance)
+{
+    int count = int(path.size());
+    if (count < 3)
+    {
+        return;
+    }
+
+    int kept = 1;
+    for (int i = 1; i < count - 1; ++i)
+    {
+        b2Vec2 in = b2Sub(path[i], path[kept - 1]);
+        b2Vec2 out = b2Sub(path[i + 1], path[i]);
+        float lengths = b2Length(in) * b2Length(out);
+
+        // Keep real turns and reversals, drop vertices in a straight run
+        bool straight = b2Dot(in, out) > 0.0f && b2AbsFloat(b2Cross(in, out)) <= tolerance * lengths;
+        if (straight == false)
+        {
+            path[kept++] = path[i];
+        }
+    }
+
+    path[kept++] = path[count - 1];
+    path.resize(kept);
+}
+
+void SmoothPath(std::vector<b2Vec2> &path, const ObstacleIndex &obstacles)
+{
+    ShortcutPath(path, obstacles);
+    RemoveCollinearPoints(path, 0.01f);
+}
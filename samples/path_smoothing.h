@@ -0,0 +1,18 @@
+#pragma once
+
+#include "box2d/types.h"
+
+#include <vector>
+
+class ObstacleIndex;
+
+// Greedy line of sight shortcutting: from each kept vertex jump to the farthest
+// vertex that can be reached in a straight line. Works in place.
+void ShortcutPath(std::vector<b2Vec2> &path, const ObstacleIndex &obstacles);
+
+// Drops vertices that continue in the same direction as the previous segment,
+// tolerance is the sine of the largest ignored turn.
+void RemoveCollinearPoints(std::vector<b2Vec2> &path, float tolerance);
+
+// Shortcut then collinear removal, what the planners run on a found path
+void SmoothPath(std::vector<b2Vec2> &path, const ObstacleIndex &obstacles);
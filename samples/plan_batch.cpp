@@ -0,0 +1,75 @@
+#include "plan_batch.h"
+
+#include <assert.h>
+
+PlanBatch::PlanBatch()
+{
+    m_Priority = enki::TASK_PRIORITY_LOW;
+    m_MinRange = 1; // a single plan can take the whole budget
+    m_scratch = nullptr;
+    m_inFlight = false;
+}
+
+void PlanBatch::ExecuteRange(enki::TaskSetPartition range, uint32_t threadIndex)
+{
+    PlannerScratch &scratch = m_scratch[threadIndex];
+    for (uint32_t i = range.start; i < range.end; ++i)
+    {
+        m_cows[i]->RunPlanner(scratch, m_cows[i]->plan_output);
+    }
+}
+
+bool PlanBatch::Submit(enki::TaskScheduler *scheduler, Herd &herd, PlannerScratch *scratch)
+{
+    assert(m_inFlight == false);
+
+    m_cows.clear();
+    int count = herd.GetCount();
+    for (int i = 0; i < count; ++i)
+    {
+        if (herd.states[i] == cow_planning)
+        {
+            m_cows.push_back(&herd.GetCow(i));
+        }
+    }
+
+    if (m_cows.empty())
+    {
+        return false;
+    }
+
+    m_scratch = scratch;
+    m_SetSize = uint32_t(m_cows.size());
+    m_inFlight = true;
+    scheduler->AddTaskSetToPipe(this);
+    return true;
+}
+
+bool PlanBatch::Harvest()
+{
+    if (m_inFlight == false)
+    {
+        return true;
+    }
+
+    if (GetIsComplete() == false)
+    {
+        return false;
+    }
+
+    for (Cow *cow : m_cows)
+    {
+        cow->FinishPlan(cow->plan_output);
+    }
+    m_inFlight = false;
+    return true;
+}
+
+void PlanBatch::Wait(enki::TaskScheduler *scheduler)
+{
+    if (m_inFlight)
+    {
+        scheduler->WaitforTask(this);
+    }
+    Harvest();
+}
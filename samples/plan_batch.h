@@ -0,0 +1,32 @@
+#pragma once
+
+#include "herd.h"
+
+#include "TaskScheduler.h"
+
+#include <vector>
+
+// Plans every cow left in cow_planning as one task set on the sample scheduler. Low
+// priority, so threads waiting on the physics never pick it up. Each thread plans with
+// its own PlannerScratch and the results are applied on the calling thread in cow
+// order, so stats and the route cache do not depend on the thread count.
+class PlanBatch : public enki::ITaskSet
+{
+public:
+    PlanBatch();
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadIndex) override;
+
+    // Collects the waiting cows and starts the batch, false when there is nothing to plan.
+    // scratch needs one entry per scheduler thread.
+    bool Submit(enki::TaskScheduler *scheduler, Herd &herd, PlannerScratch *scratch);
+    bool Harvest(); // applies a finished batch, false while it is still running
+    void Wait(enki::TaskScheduler *scheduler); // helps with the batch, then applies it
+
+    bool IsInFlight() const { return m_inFlight; }
+    int GetCount() const { return int(m_cows.size()); }
+
+private:
+    std::vector<Cow *> m_cows;
+    PlannerScratch *m_scratch;
+    bool m_inFlight;
+};
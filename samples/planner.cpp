@@ -0,0 +1,15 @@
+#include "planner.h"
+
+#include "box2d/math_functions.h"
+
+const char *planner_engine_names[engine_count] = {"RRT", "Grid A*", "Grid JPS", "Flow field", "Visibility", "HPA*"};
+
+float PathLength(const std::vector<b2Vec2> &path)
+{
+    float length = 0.0f;
+    for (size_t i = 1; i < path.size(); ++i)
+    {
+        length += b2Distance(path[i - 1], path[i]);
+    }
+    return length;
+}
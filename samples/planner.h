@@ -0,0 +1,88 @@
+#pragma once
+
+#include "box2d/math_functions.h"
+#include "box2d/types.h"
+
+#include <vector>
+
+// Only a search the budget cut short is partial. One that empties its open list means
+// the goal is walled off, a partial path would only lead to another failed plan.
+enum plan_status
+{
+    plan_found,       // path ends at the goal, within goal_threshold for RRT
+    plan_partial,     // budget ran out, path ends at the node closest to the goal
+    plan_unreachable, // no way to the goal, or no progress within the budget
+};
+
+// Limits for a single plan, whichever is hit first ends the search. The clock
+// depends on the machine, with max_milliseconds <= 0 only iterations count and
+// a seeded plan gives the same path on every run.
+struct PlanBudget
+{
+    int max_iterations = 20000;
+    float max_milliseconds = 4.0f;
+};
+
+struct PlanResult
+{
+    plan_status status = plan_unreachable;
+    std::vector<b2Vec2> path;
+    int iterations = 0;
+};
+
+// Path planner a simulation runs its cows with
+enum planner_engine
+{
+    engine_rrt,   // sampling based, see rrt_mode for the variants
+    engine_astar, // A* over the occupancy grid
+    engine_jps,   // Jump Point Search over the occupancy grid
+    engine_flow,  // follows the flow field of the destination, no planning
+    engine_visibility, // A* over the corners of the inflated obstacles
+    engine_hierarchical, // HPA* over chunks of the occupancy grid
+    engine_count,
+};
+
+extern const char *planner_engine_names[engine_count];
+
+// Cost of the plans made with one engine, lengths are only summed for found paths
+struct EngineStats
+{
+    long long plans = 0;
+    long long found = 0;
+    long long expanded = 0; // RRT iterations or grid nodes expanded
+    double milliseconds = 0.0;
+    double path_length = 0.0;
+
+    float MillisecondsPerPlan() const { return plans > 0 ? float(milliseconds / plans) : 0.0f; }
+    float ExpandedPerPlan() const { return plans > 0 ? float(expanded) / float(plans) : 0.0f; }
+    float LengthPerPath() const { return found > 0 ? float(path_length / found) : 0.0f; }
+
+    void Add(const EngineStats &other)
+    {
+        plans += other.plans;
+        found += other.found;
+        expanded += other.expanded;
+        milliseconds += other.milliseconds;
+        path_length += other.path_length;
+    }
+};
+
+float PathLength(const std::vector<b2Vec2> &path);
+
+// Cost of a diagonal step on the occupancy grid, a straight step costs one
+const float k_diagonalCost = 1.41421356f;
+
+// Octile distance in cells, exact on an open grid
+inline float Octile(int dx, int dy)
+{
+    dx = b2AbsInt(dx);
+    dy = b2AbsInt(dy);
+    int diagonal = b2MinInt(dx, dy);
+    return float(b2MaxInt(dx, dy) - diagonal) + k_diagonalCost * float(diagonal);
+}
+
+// Heap order of the A* open lists, pops the lowest f first, deeper nodes first on ties
+inline bool OpenLess(float fa, float ga, float fb, float gb)
+{
+    return fa > fb || (fa == fb && ga < gb);
+}
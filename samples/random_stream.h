@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+// SplitMix64 step, used to expand and combine seeds
+inline uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Seed of sub stream index of seed, e.g. cow i of a scenario or plan n of a cow
+inline uint64_t MixSeed(uint64_t seed, uint64_t index)
+{
+    uint64_t state = seed ^ SplitMix64(index);
+    return SplitMix64(state);
+}
+
+// xoshiro128** generator. Every cow and every plan owns its own stream seeded
+// from the scenario seed, so results do not depend on which thread draws them or
+// in what order. Draws are plain integer math and identical on every platform.
+class RandomStream
+{
+public:
+    RandomStream() { Seed(0); }
+    explicit RandomStream(uint64_t seed) { Seed(seed); }
+
+    void Seed(uint64_t seed)
+    {
+        uint64_t state = seed;
+        uint64_t a = SplitMix64(state);
+        uint64_t b = SplitMix64(state);
+        m_state[0] = uint32_t(a);
+        m_state[1] = uint32_t(a >> 32);
+        m_state[2] = uint32_t(b);
+        m_state[3] = uint32_t(b >> 32);
+    }
+
+    uint32_t Next()
+    {
+        uint32_t result = Rotate(m_state[1] * 5, 7) * 9;
+        uint32_t t = m_state[1] << 9;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = Rotate(m_state[3], 11);
+        return result;
+    }
+
+    // [0, 1)
+    float NextFloat() { return float(Next() >> 8) * (1.0f / 16777216.0f); }
+
+    // [lo, hi)
+    float NextFloat(float lo, float hi) { return lo + (hi - lo) * NextFloat(); }
+
+    // [0, count), count > 0
+    int NextInt(int count) { return int((uint64_t(Next()) * uint64_t(count)) >> 32); }
+
+private:
+    static uint32_t Rotate(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+    uint32_t m_state[4];
+};
@@ -0,0 +1,136 @@
+#include "route_cache.h"
+
+#include <assert.h>
+#include <iterator>
+
+RouteCache::RouteCache(int capacity)
+{
+    assert(capacity > 0);
+    m_capacity = capacity;
+    m_version = 0;
+}
+
+uint64_t RouteCache::MakeKey(int start_cell, int area, planner_engine engine, int variant)
+{
+    // 32 bits of cell, 24 bits of area, 4 bits each of variant and engine
+    return (uint64_t(uint32_t(start_cell)) << 32) | (uint64_t(uint32_t(area) & 0xFFFFFF) << 8) |
+           (uint64_t(variant & 0xF) << 4) | uint64_t(engine & 0xF);
+}
+
+void RouteCache::CheckVersion(int version)
+{
+    if (version != m_version)
+    {
+        if (!m_entries.empty())
+        {
+            m_stats.invalidations += 1;
+        }
+        m_entries.clear();
+        m_lookup.clear();
+        m_version = version;
+    }
+}
+
+bool RouteCache::Find(int start_cell, int area, planner_engine engine, int variant, int version,
+                      std::vector<b2Vec2> &path)
+{
+    CheckVersion(version);
+    m_stats.lookups += 1;
+
+    auto it = m_lookup.find(MakeKey(start_cell, area, engine, variant));
+    if (it == m_lookup.end())
+    {
+        return false;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    path = it->second->path;
+    m_stats.hits += 1;
+    return true;
+}
+
+void RouteCache::Insert(int start_cell, int area, planner_engine engine, int variant, int version,
+                        const std::vector<b2Vec2> &path)
+{
+    CheckVersion(version);
+    uint64_t key = MakeKey(start_cell, area, engine, variant);
+
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end())
+    {
+        it->second->path = path;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    if (int(m_entries.size()) >= m_capacity)
+    {
+        // Recycle the least recently used entry, keeps its path capacity
+        m_lookup.erase(m_entries.back().key);
+        m_entries.splice(m_entries.begin(), m_entries, std::prev(m_entries.end()));
+        m_stats.evictions += 1;
+    }
+    else
+    {
+        m_entries.emplace_front();
+    }
+
+    Entry &entry = m_entries.front();
+    entry.key = key;
+    entry.path = path;
+    m_lookup[key] = m_entries.begin();
+}
+
+void RouteCache::Clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+    m_stats = RouteCacheStats();
+}
+
+int RouteCache::ApplyEdit(const std::vector<int> &area_remap, const ObstacleIndex &blocked)
+{
+    // Keys change with the areas, so the lookup is rebuilt from the surviving entries
+    m_lookup.clear();
+    int dropped = 0;
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        int startCell = int(it->key >> 32);
+        int area = int((it->key >> 8) & 0xFFFFFF);
+        planner_engine engine = planner_engine(it->key & 0xF);
+        int variant = int((it->key >> 4) & 0xF);
+        int newArea = area < int(area_remap.size()) ? area_remap[area] : -1;
+
+        bool broken = newArea < 0;
+        for (size_t i = 1; i < it->path.size() && !broken; ++i)
+        {
+            broken = blocked.SegmentBlocked(it->path[i - 1], it->path[i]);
+        }
+
+        if (broken)
+        {
+            it = m_entries.erase(it);
+            dropped += 1;
+            continue;
+        }
+
+        it->key = MakeKey(startCell, newArea, engine, variant);
+        m_lookup[it->key] = it;
+        ++it;
+    }
+
+    m_stats.edit_drops += dropped;
+    return dropped;
+}
+
+void RouteCache::SetCapacity(int capacity)
+{
+    assert(capacity > 0);
+    m_capacity = capacity;
+    while (int(m_entries.size()) > m_capacity)
+    {
+        m_lookup.erase(m_entries.back().key);
+        m_entries.pop_back();
+        m_stats.evictions += 1;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "obstacle_index.h"
+#include "planner.h"
+
+#include "box2d/types.h"
+
+#include <list>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+struct RouteCacheStats
+{
+    long long lookups = 0;
+    long long hits = 0;
+    long long evictions = 0;
+    long long invalidations = 0; // whole cache dropped after a layout change
+    long long edit_drops = 0;    // single routes dropped by layout edits
+
+    float HitRate() const { return lookups > 0 ? float(hits) / float(lookups) : 0.0f; }
+};
+
+// Bounded LRU cache of found paths, keyed on the start cell, the destination
+// area, the engine that planned it and the engine variant (the rrt_mode for RRT). Entries belong to one layout version, a
+// lookup or insert with a newer version drops the whole cache. Small edits go
+// through ApplyEdit instead and only drop the routes they break.
+class RouteCache
+{
+public:
+    explicit RouteCache(int capacity = 4096);
+
+    // Copies the cached path into path and marks the entry most recently used
+    bool Find(int start_cell, int area, planner_engine engine, int variant, int version, std::vector<b2Vec2> &path);
+    void Insert(int start_cell, int area, planner_engine engine, int variant, int version,
+                const std::vector<b2Vec2> &path);
+    void Clear();
+
+    // After a layout edit: moves entries to area_remap[area], drops those whose area is
+    // gone (-1) or whose path hits blocked. Routes past freed cells are kept, they are
+    // still valid, just maybe longer. Returns the number of routes dropped.
+    int ApplyEdit(const std::vector<int> &area_remap, const ObstacleIndex &blocked);
+
+    void SetCapacity(int capacity);
+    int GetCapacity() const { return m_capacity; }
+    int GetCount() const { return int(m_entries.size()); }
+    const RouteCacheStats &GetStats() const { return m_stats; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        std::vector<b2Vec2> path;
+    };
+
+    static uint64_t MakeKey(int start_cell, int area, planner_engine engine, int variant);
+    void CheckVersion(int version);
+
+    int m_capacity;
+    int m_version;
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_lookup;
+    RouteCacheStats m_stats;
+};
@@ -1,18 +1,79 @@
 #include "rrt.h"
-#include "sample.h"
+#include "path_smoothing.h"
 
 #include "box2d/box2d.h"
 #include "box2d/math_functions.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
+
+NodeArena::NodeArena()
+{
+    m_count = 0;
+}
+
+Node *NodeArena::Allocate(b2Vec2 position, Node *parent)
+{
+    int chunk = m_count / e_chunkSize;
+    if (chunk == int(m_chunks.size()))
+    {
+        // Only grows while the planner warms up, later plans reuse the chunks
+        m_chunks.emplace_back(new Node[e_chunkSize]);
+    }
+
+    Node *node = &m_chunks[chunk][m_count % e_chunkSize];
+    node->position = position;
+    node->parent = parent;
+    node->first_child = nullptr;
+    node->next_sibling = nullptr;
+    node->cost = 0.0f;
+    if (parent != nullptr)
+    {
+        node->next_sibling = parent->first_child;
+        parent->first_child = node;
+        node->cost = parent->cost + b2Distance(parent->position, position);
+    }
+    ++m_count;
+    return node;
+}
+
+void NodeArena::Reset()
+{
+    m_count = 0;
+}
+
+const char *rrt_mode_names[rrt_mode_count] = {"Uniform", "Goal biased", "Connect", "RRT*"};
 
 RRT::RRT()
 {
     root = nullptr; // Initialize root as nullptr
+    goal_root = nullptr;
+    obstacles = nullptr;
+    start_blocked = false;
+    max_barn_area = b2Vec2{0.0f, 0.0f};
+    step_size = 24.0f;
+    goal_threshold = 0.0f;
+    star_cost = std::numeric_limits<float>::max();
+}
+
+void RRT::Reset()
+{
+    // Keeps the arena chunks and the capacity of nodes
+    root = nullptr;
+    goal_root = nullptr;
+    nodes.clear();
+    goal_nodes.clear();
+    star_goals.clear();
+    star_cost = std::numeric_limits<float>::max();
+    arena.Reset();
+    node_grid.Reset(max_barn_area, 24.0f); // one grid cell per barn cell
+    goal_grid.Reset(max_barn_area, 24.0f);
 }
 
-std::vector<b2Vec2> RRT::FindPath(b2Vec2 start, b2Vec2 goal, std::vector<b2AABB> obstacles, b2Vec2 max_barn_area, float step_size, float goal_threshold)
+void RRT::Begin(b2Vec2 start, b2Vec2 goal, const ObstacleIndex *obstacles, b2Vec2 max_barn_area, float step_size,
+                float goal_threshold)
 {
     this->start = start;
     this->goal = goal;
@@ -20,103 +81,466 @@ std::vector<b2Vec2> RRT::FindPath(b2Vec2 start, b2Vec2 goal, std::vector<b2AABB>
     this->max_barn_area = max_barn_area;
     this->step_size = step_size;
     this->goal_threshold = goal_threshold;
-    root = new Node{start, nullptr};
+    Reset();
+    start_blocked = obstacles->PointBlocked(start, 0.0f);
+    root = arena.Allocate(start, nullptr);
     nodes.push_back(root);
+    node_grid.Insert(root);
+}
+
+PlanResult RRT::FindPath(b2Vec2 start, b2Vec2 goal, const ObstacleIndex *obstacles, b2Vec2 max_barn_area, float step_size,
+                         float goal_threshold, const PlanBudget &budget)
+{
+    Begin(start, goal, obstacles, max_barn_area, step_size, goal_threshold);
+
+    // Connect needs a free point near the goal, the goal itself is inside its area
+    rrt_mode planMode = mode;
+    if (planMode == rrt_connect && SeedGoalTree() == false)
+    {
+        planMode = rrt_goal_biased;
+    }
+
+    PlanResult result;
+    if (planMode == rrt_connect)
+    {
+        result = GrowConnectTrees(budget);
+    }
+    else if (planMode == rrt_star)
+    {
+        // Anytime, the first path is returned and RefineStar improves it later
+        result = GrowStarTree(budget, true);
+    }
+    else
+    {
+        result = GrowSingleTree(budget);
+    }
+
+    ModeStats &stats = mode_stats[planMode];
+    int rawVertices = int(result.path.size());
+    if (smooth_paths)
+    {
+        SmoothPath(result.path, *obstacles);
+    }
 
-    int i_try = 0;
-    while (true)
+    stats.plans += 1;
+    if (result.status == plan_found)
     {
-        ++i_try;
+        stats.found += 1;
+        stats.iterations_to_solution += result.iterations;
+        stats.raw_vertices += rawVertices;
+        stats.smooth_vertices += result.path.size();
+    }
+    return result;
+}
+
+PlanResult RRT::GrowSingleTree(const PlanBudget &budget)
+{
+    // Best effort in case the budget runs out
+    Node *closest = root;
+    float closestDist = b2DistanceSquared(start, goal);
+
+    b2Timer timer = b2CreateTimer();
+    PlanResult result;
+    while (result.iterations < budget.max_iterations)
+    {
+        ++result.iterations;
         b2Vec2 randPoint = SampleRandomPoint();
+        if (mode == rrt_goal_biased && random.NextFloat() < goal_bias)
+        {
+            randPoint = goal;
+        }
+
         Node *nearest = FindNearestNode(randPoint);
         Node *newNode = ExtendTree(nearest, randPoint);
 
         if (newNode && IsGoalReached(newNode))
         {
-            return BuildPath(newNode);
+            result.status = plan_found;
+            result.path = BuildPath(newNode);
+            return result;
+        }
+
+        if (newNode)
+        {
+            float dist = b2DistanceSquared(newNode->position, goal);
+            if (dist < closestDist)
+            {
+                closest = newNode;
+                closestDist = dist;
+            }
         }
+
+        // Reading the clock is not free, check it every few iterations
+        if ((result.iterations & 63) == 0 && budget.max_milliseconds > 0.0f &&
+            b2GetMilliseconds(&timer) > budget.max_milliseconds)
+        {
+            break;
+        }
+    }
+
+    if (closest != root)
+    {
+        result.status = plan_partial;
+        result.path = BuildPath(closest);
     }
+    else
+    {
+        result.status = plan_unreachable;
+    }
+    return result;
 }
 
-b2Vec2 RRT::SampleRandomPoint()
+PlanResult RRT::RefineStar(const PlanBudget &budget)
 {
-    float x = static_cast<float>(rand()) / RAND_MAX * max_barn_area.x;
-    float y = static_cast<float>(rand()) / RAND_MAX * max_barn_area.y;
-    return b2Vec2{x, y};
+    assert(root != nullptr);
+    PlanResult result = GrowStarTree(budget, false);
+    if (result.status == plan_found && smooth_paths)
+    {
+        SmoothPath(result.path, *obstacles);
+    }
+    return result;
 }
 
-Node *RRT::FindNearestNode(b2Vec2 point)
+PlanResult RRT::GrowStarTree(const PlanBudget &budget, bool stop_at_first)
 {
-    Node *nearest = nullptr;
-    float minDist = std::numeric_limits<float>::max();
-    for (Node *node : nodes)
+    // Best effort in case the budget runs out
+    Node *closest = root;
+    float closestDist = b2DistanceSquared(start, goal);
+
+    b2Timer timer = b2CreateTimer();
+    PlanResult result;
+    while (result.iterations < budget.max_iterations)
     {
-        float dist = b2DistanceSquared(point, node->position); // Prefer squared distance
-        if (dist < minDist)
+        ++result.iterations;
+        b2Vec2 randPoint = SampleRandomPoint();
+        if (random.NextFloat() < goal_bias)
         {
-            nearest = node;
-            minDist = dist;
+            randPoint = goal;
+        }
+
+        Node *newNode = ExtendStar(FindNearestNode(randPoint), randPoint);
+        if (newNode != nullptr)
+        {
+            if (IsGoalReached(newNode))
+            {
+                star_goals.push_back(newNode);
+                if (stop_at_first)
+                {
+                    break;
+                }
+            }
+
+            float dist = b2DistanceSquared(newNode->position, goal);
+            if (dist < closestDist)
+            {
+                closest = newNode;
+                closestDist = dist;
+            }
+        }
+
+        // Rewiring makes iterations slower, check the clock more often than the other modes
+        if ((result.iterations & 7) == 0 && budget.max_milliseconds > 0.0f &&
+            b2GetMilliseconds(&timer) > budget.max_milliseconds)
+        {
+            break;
         }
     }
-    return nearest;
+
+    // Rewiring can shorten any goal node, so all of them are compared again
+    Node *best = nullptr;
+    star_cost = std::numeric_limits<float>::max();
+    for (Node *node : star_goals)
+    {
+        float cost = node->cost + b2Distance(node->position, goal);
+        if (cost < star_cost)
+        {
+            best = node;
+            star_cost = cost;
+        }
+    }
+
+    if (best != nullptr)
+    {
+        result.status = plan_found;
+        result.path = BuildPath(best);
+    }
+    else if (closest != root)
+    {
+        result.status = plan_partial;
+        result.path = BuildPath(closest);
+    }
+    else
+    {
+        result.status = plan_unreachable;
+    }
+    return result;
 }
 
-Node *RRT::ExtendTree(Node *nearest, b2Vec2 point)
+Node *RRT::ExtendStar(Node *nearest, b2Vec2 point)
 {
     b2Vec2 direction = point - nearest->position;
-    // direction.Normalize();
-    float length = b2Length(direction); // Get the length of the vector
-    if (length > 0.0f)
+    float length = b2Length(direction);
+    if (length == 0.0f)
+    {
+        return nullptr;
+    }
+    direction *= 1.0f / length;
+    b2Vec2 newPosition = length > step_size ? nearest->position + direction * step_size : point;
+    if (EdgeBlocked(nearest, newPosition))
     {
-        direction *= 1.0f / length; // Normalize the vector
+        return nullptr;
     }
-    b2Vec2 newPosition = nearest->position + direction * step_size;
 
-    if (!ObstaclesInBetween(nearest->position, newPosition, obstacles))
+    near_nodes.clear();
+    nearest_stats.nodes_visited += node_grid.FindNear(newPosition, rewire_radius, &near_nodes);
+
+    // Cheapest parent in the neighbourhood
+    Node *parent = nearest;
+    float cost = nearest->cost + b2Distance(nearest->position, newPosition);
+    for (Node *node : near_nodes)
     {
-        Node *newNode = new Node{newPosition, nearest};
-        nodes.push_back(newNode);
-        return newNode;
+        float nodeCost = node->cost + b2Distance(node->position, newPosition);
+        if (nodeCost < cost && node != nearest && !EdgeBlocked(node, newPosition))
+        {
+            parent = node;
+            cost = nodeCost;
+        }
+    }
+
+    Node *newNode = arena.Allocate(newPosition, parent);
+    nodes.push_back(newNode);
+    node_grid.Insert(newNode);
+
+    // Neighbours that are cheaper through the new node hang from it
+    for (Node *node : near_nodes)
+    {
+        if (node == root || node == parent)
+        {
+            continue;
+        }
+
+        float nodeCost = newNode->cost + b2Distance(newPosition, node->position);
+        if (nodeCost < node->cost && !ObstaclesInBetween(newPosition, node->position))
+        {
+            Reparent(node, newNode, nodeCost);
+        }
+    }
+    return newNode;
+}
+
+bool RRT::EdgeBlocked(Node *from, b2Vec2 to)
+{
+    // A cow pushed into the clearance band may step out of it from the root
+    return from == root && start_blocked ? obstacles->PointBlocked(to, 0.0f) : ObstaclesInBetween(from->position, to);
+}
+
+void RRT::Reparent(Node *node, Node *parent, float cost)
+{
+    Node **link = &node->parent->first_child;
+    while (*link != node)
+    {
+        link = &(*link)->next_sibling;
+    }
+    *link = node->next_sibling;
+
+    node->parent = parent;
+    node->next_sibling = parent->first_child;
+    parent->first_child = node;
+
+    // Every node below gets shorter by the same amount
+    float delta = cost - node->cost;
+    node->cost = cost;
+    subtree.clear();
+    for (Node *child = node->first_child; child != nullptr; child = child->next_sibling)
+    {
+        subtree.push_back(child);
+    }
+    while (subtree.empty() == false)
+    {
+        Node *child = subtree.back();
+        subtree.pop_back();
+        child->cost += delta;
+        for (Node *grandchild = child->first_child; grandchild != nullptr; grandchild = grandchild->next_sibling)
+        {
+            subtree.push_back(grandchild);
+        }
     }
-    return nullptr;
 }
 
-bool RRT::ObstaclesInBetween(b2Vec2 from, b2Vec2 to, std::vector<b2AABB> obstacles)
+bool RRT::SeedGoalTree()
 {
-    for (const auto &obstacle : obstacles)
+    // Closest free point around the goal that still counts as reaching it
+    const int directionCount = 16;
+    for (float radius = 0.5f * step_size; radius < goal_threshold; radius += 0.5f * step_size)
     {
-        if (RayIntersectsAABB(obstacle, from, to))
+        for (int i = 0; i < directionCount; ++i)
         {
-            return true;
+            b2Rot direction = b2MakeRot(2.0f * b2_pi * i / directionCount);
+            b2Vec2 point = b2MulAdd(goal, radius, {direction.c, direction.s});
+            if (obstacles->PointBlocked(point, 0.0f) == false)
+            {
+                goal_root = arena.Allocate(point, nullptr);
+                goal_nodes.push_back(goal_root);
+                goal_grid.Insert(goal_root);
+                return true;
+            }
         }
     }
     return false;
 }
 
-bool RRT::RayIntersectsAABB(b2AABB aabb, b2Vec2 from_, b2Vec2 to_)
+PlanResult RRT::GrowConnectTrees(const PlanBudget &budget)
 {
-    float tmin = (aabb.lowerBound.x - from_.x) / (to_.x - from_.x);
-    float tmax = (aabb.upperBound.x - from_.x) / (to_.x - from_.x);
+    // Tree a extends toward the sample, tree b then connects toward the new node
+    std::vector<Node *> *treeA = &nodes;
+    std::vector<Node *> *treeB = &goal_nodes;
+    NodeGrid *gridA = &node_grid;
+    NodeGrid *gridB = &goal_grid;
 
-    if (tmin > tmax)
-        std::swap(tmin, tmax);
+    Node *closest = root;
+    float closestDist = b2DistanceSquared(start, goal_root->position);
 
-    float tymin = (aabb.lowerBound.y - from_.y) / (to_.y - from_.y);
-    float tymax = (aabb.upperBound.y - from_.y) / (to_.y - from_.y);
+    b2Timer timer = b2CreateTimer();
+    PlanResult result;
+    while (result.iterations < budget.max_iterations)
+    {
+        ++result.iterations;
+        b2Vec2 randPoint = SampleRandomPoint();
+        Node *newA = ExtendTree(*treeA, *gridA, FindNearestNode(*treeA, *gridA, randPoint), randPoint);
 
-    if (tymin > tymax)
-        std::swap(tymin, tymax);
+        if (newA != nullptr)
+        {
+            Node *nodeB = FindNearestNode(*treeB, *gridB, newA->position);
+            while (nodeB != nullptr && b2DistanceSquared(nodeB->position, newA->position) > 0.0f)
+            {
+                Node *next = ExtendTree(*treeB, *gridB, nodeB, newA->position);
+                if (next == nullptr)
+                {
+                    break;
+                }
+                nodeB = next;
+            }
 
-    if ((tmin > tymax) || (tymin > tmax))
-        return false;
+            if (nodeB != nullptr && nodeB->position == newA->position)
+            {
+                // Start tree half runs forward, goal tree half runs backward to the seed
+                Node *startSide = treeA == &nodes ? newA : nodeB;
+                Node *goalSide = treeA == &nodes ? nodeB : newA;
+                result.status = plan_found;
+                result.path = BuildPath(startSide);
+                for (Node *node = goalSide->parent; node != nullptr; node = node->parent)
+                {
+                    result.path.push_back(node->position);
+                }
+                return result;
+            }
 
-    if (tymin > tmin)
-        tmin = tymin;
+            if (treeA == &nodes)
+            {
+                float dist = b2DistanceSquared(newA->position, goal_root->position);
+                if (dist < closestDist)
+                {
+                    closest = newA;
+                    closestDist = dist;
+                }
+            }
+        }
 
-    if (tymax < tmax)
-        tmax = tymax;
+        std::swap(treeA, treeB);
+        std::swap(gridA, gridB);
 
-    return (tmax >= 0);
+        // Reading the clock is not free, check it every few iterations
+        if ((result.iterations & 63) == 0 && budget.max_milliseconds > 0.0f &&
+            b2GetMilliseconds(&timer) > budget.max_milliseconds)
+        {
+            break;
+        }
+    }
+
+    if (closest != root)
+    {
+        result.status = plan_partial;
+        result.path = BuildPath(closest);
+    }
+    else
+    {
+        result.status = plan_unreachable;
+    }
+    return result;
+}
+
+b2Vec2 RRT::SampleRandomPoint()
+{
+    float x = random.NextFloat() * max_barn_area.x;
+    float y = random.NextFloat() * max_barn_area.y;
+    return b2Vec2{x, y};
+}
+
+Node *RRT::FindNearestNode(b2Vec2 point)
+{
+    return FindNearestNode(nodes, node_grid, point);
+}
+
+Node *RRT::FindNearestNode(const std::vector<Node *> &tree, const NodeGrid &grid, b2Vec2 point)
+{
+    nearest_stats.queries += 1;
+
+    if (use_node_grid && int(tree.size()) >= brute_force_limit)
+    {
+        int visited = 0;
+        Node *nearest = grid.FindNearest(point, &visited);
+        nearest_stats.nodes_visited += visited;
+        return nearest;
+    }
+
+    nearest_stats.nodes_visited += tree.size();
+    Node *nearest = nullptr;
+    float minDist = std::numeric_limits<float>::max();
+    for (Node *node : tree)
+    {
+        float dist = b2DistanceSquared(point, node->position); // Prefer squared distance
+        if (dist < minDist)
+        {
+            nearest = node;
+            minDist = dist;
+        }
+    }
+    return nearest;
+}
+
+Node *RRT::ExtendTree(Node *nearest, b2Vec2 point)
+{
+    return ExtendTree(nodes, node_grid, nearest, point);
+}
+
+Node *RRT::ExtendTree(std::vector<Node *> &tree, NodeGrid &grid, Node *nearest, b2Vec2 point)
+{
+    b2Vec2 direction = point - nearest->position;
+    // direction.Normalize();
+    float length = b2Length(direction); // Get the length of the vector
+    if (length == 0.0f)
+    {
+        return nullptr;
+    }
+    direction *= 1.0f / length; // Normalize the vector
+
+    // Stop at the point instead of stepping past it, connect relies on landing on it
+    b2Vec2 newPosition = length > step_size ? nearest->position + direction * step_size : point;
+
+    if (!EdgeBlocked(nearest, newPosition))
+    {
+        Node *newNode = arena.Allocate(newPosition, nearest);
+        tree.push_back(newNode);
+        grid.Insert(newNode);
+        return newNode;
+    }
+    return nullptr;
+}
+
+bool RRT::ObstaclesInBetween(b2Vec2 from, b2Vec2 to)
+{
+    assert(obstacles != nullptr);
+    return obstacles->SegmentBlocked(from, to);
 }
 
 bool RRT::IsGoalReached(Node *node)
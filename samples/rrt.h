@@ -1,36 +1,141 @@
 #pragma once
 
+#include "node_grid.h"
+#include "obstacle_index.h"
+#include "planner.h"
+#include "random_stream.h"
+
 #include "box2d/types.h"
 
+#include <memory>
 #include <vector>
 
 struct Node
 {
     b2Vec2 position;
-    Node *parent; // Node* to avoid infinite recursion
+    Node *parent;      // Node* to avoid infinite recursion
+    Node *first_child; // children link through next_sibling, so a rewire reaches the subtree
+    Node *next_sibling;
+    float cost; // path length from the root
+};
+
+// Chunked pool for the RRT nodes. Chunks are kept when the arena is reset, so
+// once a planner has grown to its working size it plans without touching the heap.
+class NodeArena
+{
+public:
+    NodeArena();
+
+    Node *Allocate(b2Vec2 position, Node *parent);
+    void Reset(); // O(1), keeps the chunks for the next plan
+
+    int GetCount() const { return m_count; }
+    int GetCapacity() const { return int(m_chunks.size()) * e_chunkSize; }
+
+private:
+    enum
+    {
+        e_chunkSize = 1024,
+    };
+
+    std::vector<std::unique_ptr<Node[]>> m_chunks;
+    int m_count;
+};
+
+enum rrt_mode
+{
+    rrt_uniform,     // samples the whole barn
+    rrt_goal_biased, // samples the goal with probability goal_bias
+    rrt_connect,     // grows trees from both ends and connects them greedily
+    rrt_star,        // goal biased, picks the cheapest parent and rewires, RefineStar keeps improving
+    rrt_mode_count,
+};
+
+extern const char *rrt_mode_names[rrt_mode_count];
+
+// Plans made with one mode, iterations are only summed for found paths
+struct ModeStats
+{
+    long long plans = 0;
+    long long found = 0;
+    long long iterations_to_solution = 0;
+    long long raw_vertices = 0;    // path vertices straight out of the tree
+    long long smooth_vertices = 0; // path vertices kept after smoothing
+
+    float IterationsPerSolution() const { return found > 0 ? float(iterations_to_solution) / float(found) : 0.0f; }
+    float RawVerticesPerPath() const { return found > 0 ? float(raw_vertices) / float(found) : 0.0f; }
+    float SmoothVerticesPerPath() const { return found > 0 ? float(smooth_vertices) / float(found) : 0.0f; }
+};
+
+// Nearest-neighbour query counters, accumulated over the life of the planner
+struct NearestStats
+{
+    long long queries = 0;
+    long long nodes_visited = 0;
+
+    float VisitedPerQuery() const { return queries > 0 ? float(nodes_visited) / float(queries) : 0.0f; }
 };
 
 class RRT
 {
 public:
     RRT();
-    std::vector<b2Vec2> FindPath(b2Vec2 start, b2Vec2 goal, std::vector<b2AABB> obstacles, b2Vec2 max_barn_area, float step_size, float goal_threshold);
+    PlanResult FindPath(b2Vec2 start, b2Vec2 goal, const ObstacleIndex *obstacles, b2Vec2 max_barn_area, float step_size,
+                        float goal_threshold, const PlanBudget &budget);
+    void Reset();
+
+    // Starts a tree without growing it, FindPath calls it first
+    void Begin(b2Vec2 start, b2Vec2 goal, const ObstacleIndex *obstacles, b2Vec2 max_barn_area, float step_size,
+               float goal_threshold);
 
-    Node *root;                // Node* to match dynamic allocation in cpp
+    // Keeps growing the rrt_star tree of the last plan for the budget. Found when the tree
+    // reaches the goal, the path is the cheapest so far and star_cost its length.
+    PlanResult RefineStar(const PlanBudget &budget);
+
+    rrt_mode mode = rrt_uniform;
+    float goal_bias = 0.1f; // probability of sampling the goal in rrt_goal_biased and rrt_star
+    float rewire_radius = 48.0f; // rrt_star neighbourhood, two steps
+    ModeStats mode_stats[rrt_mode_count];
+    RandomStream random; // seed before each plan for reproducible trees
+    bool smooth_paths = true; // shortcut and compress found and partial paths
+
+    Node *root;                // Node* into the arena
     std::vector<Node *> nodes; // Store pointers to Nodes
+    Node *goal_root;                // rrt_connect tree grown from the goal
+    std::vector<Node *> goal_nodes;
+    NodeGrid goal_grid;
+    NodeArena arena;           // Owns the Nodes, reset between plans
+    NodeGrid node_grid;        // Spatial index over nodes, built as the tree grows
+    bool use_node_grid = true; // false forces the brute force nearest search
+    int brute_force_limit = 32; // trees smaller than this are scanned linearly
+    NearestStats nearest_stats;
     b2Vec2 start;
     b2Vec2 goal;
     b2Vec2 max_barn_area;
     float step_size;
     float goal_threshold;
-    std::vector<b2AABB> obstacles;
+    const ObstacleIndex *obstacles; // Shared, owned by MapMaker
+    std::vector<Node *> star_goals; // rrt_star nodes within goal_threshold
+    std::vector<Node *> near_nodes; // rewire scratch
+    std::vector<Node *> subtree;    // Reparent scratch
+    float star_cost;                // length of the best rrt_star path, through the goal
+    bool start_blocked;             // start is inside the inflated obstacles
+
+    PlanResult GrowSingleTree(const PlanBudget &budget);
+    PlanResult GrowConnectTrees(const PlanBudget &budget);
+    PlanResult GrowStarTree(const PlanBudget &budget, bool stop_at_first);
+    Node *ExtendStar(Node *nearest, b2Vec2 point);
+    bool EdgeBlocked(Node *from, b2Vec2 to);
+    void Reparent(Node *node, Node *parent, float cost); // moves the subtree costs along
+    bool SeedGoalTree();
 
     b2Vec2 SampleRandomPoint();
     Node *FindNearestNode(b2Vec2 point);           // Return pointer
+    Node *FindNearestNode(const std::vector<Node *> &tree, const NodeGrid &grid, b2Vec2 point);
     Node *ExtendTree(Node *nearest, b2Vec2 point); // Return pointer
-    bool ObstaclesInBetween(b2Vec2 from, b2Vec2 to, std::vector<b2AABB> obstacles);
+    Node *ExtendTree(std::vector<Node *> &tree, NodeGrid &grid, Node *nearest, b2Vec2 point);
+    bool ObstaclesInBetween(b2Vec2 from, b2Vec2 to);
     bool IsGoalReached(Node *node);            // Parameter is a pointer
     std::vector<b2Vec2> BuildPath(Node *node); // Parameter is a pointer
-    bool RayIntersectsAABB(b2AABB aabb, b2Vec2 from_, b2Vec2 to_);
     // bool InObstace(b2Vec2 point, std::vector<b2AABB> obstacles,  float inflate);
 };
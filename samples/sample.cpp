@@ -46,7 +46,8 @@ static void FinishTask(void *taskPtr, void *userContext)
 	{
 		SampleTask *sampleTask = static_cast<SampleTask *>(taskPtr);
 		Sample *sample = static_cast<Sample *>(userContext);
-		sample->m_scheduler.WaitforTask(sampleTask);
+		// Only help with tasks as urgent as this one, so background work like planning never stalls a step
+		sample->m_scheduler.WaitforTask(sampleTask, sampleTask->m_Priority);
 	}
 }
 
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "barn_layout.h"
+
 #include "box2d/collision.h"
 #include "box2d/id.h"
 #include "box2d/types.h"
@@ -56,14 +58,6 @@ public:
 constexpr int32_t maxTasks = 64;
 constexpr int32_t maxThreads = 64;
 
-struct SampleFunctionalArea
-{
-	int type;		 // cubicle, feeder, drinker, etc
-	int orientation; // horizontal or vertical
-	float x;		 // center
-	float y;		 // center
-};
-
 class Sample
 {
 public:
@@ -0,0 +1,258 @@
+#include "segment_kernel.h"
+
+#include "x86/avx2.h"
+
+#include <assert.h>
+#include <float.h>
+
+void AABBSoA::Assign(const std::vector<b2AABB> &aabbs)
+{
+    count = int(aabbs.size());
+    padded_count = ((count + e_blockSize - 1) / e_blockSize) * e_blockSize;
+
+    // Inverted boxes fail the bounds overlap so the padding never hits
+    lower_x.assign(padded_count, FLT_MAX);
+    lower_y.assign(padded_count, FLT_MAX);
+    upper_x.assign(padded_count, -FLT_MAX);
+    upper_y.assign(padded_count, -FLT_MAX);
+
+    for (int i = 0; i < count; ++i)
+    {
+        lower_x[i] = aabbs[i].lowerBound.x;
+        lower_y[i] = aabbs[i].lowerBound.y;
+        upper_x[i] = aabbs[i].upperBound.x;
+        upper_y[i] = aabbs[i].upperBound.y;
+    }
+}
+
+void AABBSoA::Clear()
+{
+    lower_x.clear();
+    lower_y.clear();
+    upper_x.clear();
+    upper_y.clear();
+    count = 0;
+    padded_count = 0;
+}
+
+SegmentQuery MakeSegmentQuery(b2Vec2 from, b2Vec2 to)
+{
+    SegmentQuery query;
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    query.from_x = from.x;
+    query.from_y = from.y;
+    query.fixed_x = dx == 0.0f;
+    query.fixed_y = dy == 0.0f;
+    query.inv_dx = query.fixed_x ? 0.0f : 1.0f / dx;
+    query.inv_dy = query.fixed_y ? 0.0f : 1.0f / dy;
+    query.min_x = from.x < to.x ? from.x : to.x;
+    query.min_y = from.y < to.y ? from.y : to.y;
+    query.max_x = from.x < to.x ? to.x : from.x;
+    query.max_y = from.y < to.y ? to.y : from.y;
+    return query;
+}
+
+// min and max follow the SSE rule of returning the second operand on NaN, so
+// all kernels agree on degenerate input
+static inline float MinSSE(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static inline float MaxSSE(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+bool SegmentHitsScalar(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                       const float *upper_y, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float tx1 = (lower_x[i] - query.from_x) * query.inv_dx;
+        float tx2 = (upper_x[i] - query.from_x) * query.inv_dx;
+        float ty1 = (lower_y[i] - query.from_y) * query.inv_dy;
+        float ty2 = (upper_y[i] - query.from_y) * query.inv_dy;
+
+        float txmin = query.fixed_x ? 0.0f : MinSSE(tx1, tx2);
+        float txmax = query.fixed_x ? 1.0f : MaxSSE(tx1, tx2);
+        float tymin = query.fixed_y ? 0.0f : MinSSE(ty1, ty2);
+        float tymax = query.fixed_y ? 1.0f : MaxSSE(ty1, ty2);
+
+        // Clip the slabs to the segment, not the infinite ray
+        float tmin = MaxSSE(MaxSSE(txmin, tymin), 0.0f);
+        float tmax = MinSSE(MinSSE(txmax, tymax), 1.0f);
+
+        bool overlap = lower_x[i] <= query.max_x && upper_x[i] >= query.min_x && lower_y[i] <= query.max_y &&
+                       upper_y[i] >= query.min_y;
+
+        if (overlap && tmin <= tmax)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SegmentHitsSSE2(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                     const float *upper_y, int count)
+{
+    assert(count % AABBSoA::e_blockSize == 0);
+
+    simde__m128 fromX = simde_mm_set1_ps(query.from_x);
+    simde__m128 fromY = simde_mm_set1_ps(query.from_y);
+    simde__m128 invDx = simde_mm_set1_ps(query.inv_dx);
+    simde__m128 invDy = simde_mm_set1_ps(query.inv_dy);
+    simde__m128 minX = simde_mm_set1_ps(query.min_x);
+    simde__m128 minY = simde_mm_set1_ps(query.min_y);
+    simde__m128 maxX = simde_mm_set1_ps(query.max_x);
+    simde__m128 maxY = simde_mm_set1_ps(query.max_y);
+    simde__m128 zero = simde_mm_setzero_ps();
+    simde__m128 one = simde_mm_set1_ps(1.0f);
+
+    // A fixed axis gets the slab [0, 1] so only the other axis clips
+    simde__m128 slabX = query.fixed_x ? simde_mm_setzero_ps() : simde_mm_castsi128_ps(simde_mm_set1_epi32(-1));
+    simde__m128 slabY = query.fixed_y ? simde_mm_setzero_ps() : simde_mm_castsi128_ps(simde_mm_set1_epi32(-1));
+
+    for (int i = 0; i < count; i += 4)
+    {
+        simde__m128 lx = simde_mm_loadu_ps(lower_x + i);
+        simde__m128 ly = simde_mm_loadu_ps(lower_y + i);
+        simde__m128 ux = simde_mm_loadu_ps(upper_x + i);
+        simde__m128 uy = simde_mm_loadu_ps(upper_y + i);
+
+        simde__m128 tx1 = simde_mm_mul_ps(simde_mm_sub_ps(lx, fromX), invDx);
+        simde__m128 tx2 = simde_mm_mul_ps(simde_mm_sub_ps(ux, fromX), invDx);
+        simde__m128 ty1 = simde_mm_mul_ps(simde_mm_sub_ps(ly, fromY), invDy);
+        simde__m128 ty2 = simde_mm_mul_ps(simde_mm_sub_ps(uy, fromY), invDy);
+
+        simde__m128 txmin = simde_mm_and_ps(slabX, simde_mm_min_ps(tx1, tx2));
+        simde__m128 txmax = simde_mm_or_ps(simde_mm_and_ps(slabX, simde_mm_max_ps(tx1, tx2)), simde_mm_andnot_ps(slabX, one));
+        simde__m128 tymin = simde_mm_and_ps(slabY, simde_mm_min_ps(ty1, ty2));
+        simde__m128 tymax = simde_mm_or_ps(simde_mm_and_ps(slabY, simde_mm_max_ps(ty1, ty2)), simde_mm_andnot_ps(slabY, one));
+
+        simde__m128 tmin = simde_mm_max_ps(simde_mm_max_ps(txmin, tymin), zero);
+        simde__m128 tmax = simde_mm_min_ps(simde_mm_min_ps(txmax, tymax), one);
+
+        simde__m128 hit = simde_mm_and_ps(simde_mm_cmple_ps(lx, maxX), simde_mm_cmpge_ps(ux, minX));
+        hit = simde_mm_and_ps(hit, simde_mm_and_ps(simde_mm_cmple_ps(ly, maxY), simde_mm_cmpge_ps(uy, minY)));
+        hit = simde_mm_and_ps(hit, simde_mm_cmple_ps(tmin, tmax));
+
+        if (simde_mm_movemask_ps(hit) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SegmentHitsAVX2(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                     const float *upper_y, int count)
+{
+    assert(count % AABBSoA::e_blockSize == 0);
+
+    simde__m256 fromX = simde_mm256_set1_ps(query.from_x);
+    simde__m256 fromY = simde_mm256_set1_ps(query.from_y);
+    simde__m256 invDx = simde_mm256_set1_ps(query.inv_dx);
+    simde__m256 invDy = simde_mm256_set1_ps(query.inv_dy);
+    simde__m256 minX = simde_mm256_set1_ps(query.min_x);
+    simde__m256 minY = simde_mm256_set1_ps(query.min_y);
+    simde__m256 maxX = simde_mm256_set1_ps(query.max_x);
+    simde__m256 maxY = simde_mm256_set1_ps(query.max_y);
+    simde__m256 zero = simde_mm256_setzero_ps();
+    simde__m256 one = simde_mm256_set1_ps(1.0f);
+
+    // A fixed axis gets the slab [0, 1] so only the other axis clips
+    simde__m256 slabX = query.fixed_x ? simde_mm256_setzero_ps() : simde_mm256_castsi256_ps(simde_mm256_set1_epi32(-1));
+    simde__m256 slabY = query.fixed_y ? simde_mm256_setzero_ps() : simde_mm256_castsi256_ps(simde_mm256_set1_epi32(-1));
+
+    for (int i = 0; i < count; i += 8)
+    {
+        simde__m256 lx = simde_mm256_loadu_ps(lower_x + i);
+        simde__m256 ly = simde_mm256_loadu_ps(lower_y + i);
+        simde__m256 ux = simde_mm256_loadu_ps(upper_x + i);
+        simde__m256 uy = simde_mm256_loadu_ps(upper_y + i);
+
+        simde__m256 tx1 = simde_mm256_mul_ps(simde_mm256_sub_ps(lx, fromX), invDx);
+        simde__m256 tx2 = simde_mm256_mul_ps(simde_mm256_sub_ps(ux, fromX), invDx);
+        simde__m256 ty1 = simde_mm256_mul_ps(simde_mm256_sub_ps(ly, fromY), invDy);
+        simde__m256 ty2 = simde_mm256_mul_ps(simde_mm256_sub_ps(uy, fromY), invDy);
+
+        simde__m256 txmin = simde_mm256_and_ps(slabX, simde_mm256_min_ps(tx1, tx2));
+        simde__m256 txmax =
+            simde_mm256_or_ps(simde_mm256_and_ps(slabX, simde_mm256_max_ps(tx1, tx2)), simde_mm256_andnot_ps(slabX, one));
+        simde__m256 tymin = simde_mm256_and_ps(slabY, simde_mm256_min_ps(ty1, ty2));
+        simde__m256 tymax =
+            simde_mm256_or_ps(simde_mm256_and_ps(slabY, simde_mm256_max_ps(ty1, ty2)), simde_mm256_andnot_ps(slabY, one));
+
+        simde__m256 tmin = simde_mm256_max_ps(simde_mm256_max_ps(txmin, tymin), zero);
+        simde__m256 tmax = simde_mm256_min_ps(simde_mm256_min_ps(txmax, tymax), one);
+
+        simde__m256 hit = simde_mm256_and_ps(simde_mm256_cmp_ps(lx, maxX, SIMDE_CMP_LE_OQ),
+                                             simde_mm256_cmp_ps(ux, minX, SIMDE_CMP_GE_OQ));
+        hit = simde_mm256_and_ps(hit, simde_mm256_and_ps(simde_mm256_cmp_ps(ly, maxY, SIMDE_CMP_LE_OQ),
+                                                         simde_mm256_cmp_ps(uy, minY, SIMDE_CMP_GE_OQ)));
+        hit = simde_mm256_and_ps(hit, simde_mm256_cmp_ps(tmin, tmax, SIMDE_CMP_LE_OQ));
+
+        if (simde_mm256_movemask_ps(hit) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SegmentHits(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                 const float *upper_y, int count)
+{
+#if defined(SIMDE_X86_AVX2_NATIVE)
+    return SegmentHitsAVX2(query, lower_x, lower_y, upper_x, upper_y, count);
+#else
+    // SSE2 is native on every x64 target and simde maps it to NEON elsewhere
+    return SegmentHitsSSE2(query, lower_x, lower_y, upper_x, upper_y, count);
+#endif
+}
+
+bool BoxOverlaps(b2AABB box, const float *lower_x, const float *lower_y, const float *upper_x, const float *upper_y,
+                 int count)
+{
+    assert(count % AABBSoA::e_blockSize == 0);
+
+#if defined(SIMDE_X86_AVX2_NATIVE)
+    simde__m256 minX = simde_mm256_set1_ps(box.lowerBound.x);
+    simde__m256 minY = simde_mm256_set1_ps(box.lowerBound.y);
+    simde__m256 maxX = simde_mm256_set1_ps(box.upperBound.x);
+    simde__m256 maxY = simde_mm256_set1_ps(box.upperBound.y);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        simde__m256 hit = simde_mm256_and_ps(simde_mm256_cmp_ps(simde_mm256_loadu_ps(lower_x + i), maxX, SIMDE_CMP_LE_OQ),
+                                             simde_mm256_cmp_ps(simde_mm256_loadu_ps(upper_x + i), minX, SIMDE_CMP_GE_OQ));
+        hit = simde_mm256_and_ps(hit, simde_mm256_cmp_ps(simde_mm256_loadu_ps(lower_y + i), maxY, SIMDE_CMP_LE_OQ));
+        hit = simde_mm256_and_ps(hit, simde_mm256_cmp_ps(simde_mm256_loadu_ps(upper_y + i), minY, SIMDE_CMP_GE_OQ));
+        if (simde_mm256_movemask_ps(hit) != 0)
+        {
+            return true;
+        }
+    }
+#else
+    simde__m128 minX = simde_mm_set1_ps(box.lowerBound.x);
+    simde__m128 minY = simde_mm_set1_ps(box.lowerBound.y);
+    simde__m128 maxX = simde_mm_set1_ps(box.upperBound.x);
+    simde__m128 maxY = simde_mm_set1_ps(box.upperBound.y);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        simde__m128 hit = simde_mm_and_ps(simde_mm_cmple_ps(simde_mm_loadu_ps(lower_x + i), maxX),
+                                          simde_mm_cmpge_ps(simde_mm_loadu_ps(upper_x + i), minX));
+        hit = simde_mm_and_ps(hit, simde_mm_cmple_ps(simde_mm_loadu_ps(lower_y + i), maxY));
+        hit = simde_mm_and_ps(hit, simde_mm_cmpge_ps(simde_mm_loadu_ps(upper_y + i), minY));
+        if (simde_mm_movemask_ps(hit) != 0)
+        {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
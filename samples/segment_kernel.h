@@ -0,0 +1,56 @@
+#pragma once
+
+#include "box2d/types.h"
+
+#include <vector>
+
+// Obstacle bounds in structure of arrays form so one segment can be tested
+// against 8 boxes at a time. The arrays are padded to a multiple of 8 with
+// empty boxes that never report a hit.
+struct AABBSoA
+{
+    enum
+    {
+        e_blockSize = 8,
+    };
+
+    void Assign(const std::vector<b2AABB> &aabbs);
+    void Clear();
+
+    std::vector<float> lower_x;
+    std::vector<float> lower_y;
+    std::vector<float> upper_x;
+    std::vector<float> upper_y;
+    int count = 0;        // real boxes
+    int padded_count = 0; // multiple of e_blockSize
+};
+
+// Per segment values shared by every box test. An axis the segment does not move
+// along has no slab, the bounds overlap alone decides it.
+struct SegmentQuery
+{
+    float from_x, from_y;
+    float inv_dx, inv_dy;
+    bool fixed_x, fixed_y;
+    float min_x, min_y;
+    float max_x, max_y;
+};
+
+SegmentQuery MakeSegmentQuery(b2Vec2 from, b2Vec2 to);
+
+// Each kernel returns true if the finite segment touches any of the boxes. count
+// must be a multiple of 8, SSE2 uses two 4 wide halves and AVX2 one 8 wide register.
+bool SegmentHitsScalar(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                       const float *upper_y, int count);
+bool SegmentHitsSSE2(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                     const float *upper_y, int count);
+bool SegmentHitsAVX2(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                     const float *upper_y, int count);
+
+// Widest kernel the samples were compiled for
+bool SegmentHits(const SegmentQuery &query, const float *lower_x, const float *lower_y, const float *upper_x,
+                 const float *upper_y, int count);
+
+// True if box overlaps any of the boxes, same widths as SegmentHits
+bool BoxOverlaps(b2AABB box, const float *lower_x, const float *lower_y, const float *upper_x, const float *upper_y,
+                 int count);
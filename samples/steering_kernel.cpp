@@ -0,0 +1,239 @@
+#include "steering_kernel.h"
+
+#include "box2d/math_functions.h"
+
+#include "x86/avx2.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+void SteeringSoA::Resize(int newCount)
+{
+    count = newCount;
+    padded_count = ((count + e_blockSize - 1) / e_blockSize) * e_blockSize;
+
+    position_x.resize(padded_count);
+    position_y.resize(padded_count);
+    rotation_c.resize(padded_count);
+    rotation_s.resize(padded_count);
+    waypoint_x.resize(padded_count);
+    waypoint_y.resize(padded_count);
+    linear_x.resize(padded_count);
+    linear_y.resize(padded_count);
+    angular.resize(padded_count);
+
+    // On their waypoint, so zero distance and zero speed
+    for (int i = count; i < padded_count; ++i)
+    {
+        position_x[i] = 0.0f;
+        position_y[i] = 0.0f;
+        rotation_c[i] = 1.0f;
+        rotation_s[i] = 0.0f;
+        waypoint_x[i] = 0.0f;
+        waypoint_y[i] = 0.0f;
+    }
+}
+
+void SteeringSoA::Clear()
+{
+    position_x.clear();
+    position_y.clear();
+    rotation_c.clear();
+    rotation_s.clear();
+    waypoint_x.clear();
+    waypoint_y.clear();
+    linear_x.clear();
+    linear_y.clear();
+    angular.clear();
+    count = 0;
+    padded_count = 0;
+}
+
+static inline float ClampScalar(float a, float lower, float upper)
+{
+    return a < lower ? lower : (a > upper ? upper : a);
+}
+
+void SteerScalar(SteeringSoA &soa, const SteeringParams &params)
+{
+    for (int i = 0; i < soa.padded_count; ++i)
+    {
+        float dx = soa.waypoint_x[i] - soa.position_x[i];
+        float dy = soa.waypoint_y[i] - soa.position_y[i];
+        float c = soa.rotation_c[i];
+        float s = soa.rotation_s[i];
+
+        // Waypoint in the body frame, its angle is the unwound heading error
+        float heading_error = atan2f(c * dy - s * dx, c * dx + s * dy);
+        float speed = ClampScalar(params.speed_gain * sqrtf(dx * dx + dy * dy), 0.0f, params.max_speed);
+        float steering = ClampScalar(heading_error, -params.max_steering, params.max_steering);
+
+        soa.linear_x[i] = speed * c;
+        soa.linear_y[i] = speed * s;
+        soa.angular[i] = (speed / params.leg_base) * tanf(steering);
+    }
+}
+
+// atan(a) on [0, 1] to 1e-5 radians, odd minimax polynomial
+static const float k_atan1 = 0.99997726f;
+static const float k_atan3 = -0.33262347f;
+static const float k_atan5 = 0.19354346f;
+static const float k_atan7 = -0.11643287f;
+static const float k_atan9 = 0.05265332f;
+static const float k_atan11 = -0.01172120f;
+
+static inline simde__m128 Atan2SSE2(simde__m128 y, simde__m128 x)
+{
+    simde__m128 signMask = simde_mm_set1_ps(-0.0f);
+    simde__m128 ax = simde_mm_andnot_ps(signMask, x);
+    simde__m128 ay = simde_mm_andnot_ps(signMask, y);
+
+    // Reduce to [0, 1], both zero gives zero like atan2f
+    simde__m128 big = simde_mm_max_ps(simde_mm_max_ps(ax, ay), simde_mm_set1_ps(FLT_MIN));
+    simde__m128 a = simde_mm_div_ps(simde_mm_min_ps(ax, ay), big);
+    simde__m128 a2 = simde_mm_mul_ps(a, a);
+
+    simde__m128 r = simde_mm_add_ps(simde_mm_mul_ps(a2, simde_mm_set1_ps(k_atan11)), simde_mm_set1_ps(k_atan9));
+    r = simde_mm_add_ps(simde_mm_mul_ps(a2, r), simde_mm_set1_ps(k_atan7));
+    r = simde_mm_add_ps(simde_mm_mul_ps(a2, r), simde_mm_set1_ps(k_atan5));
+    r = simde_mm_add_ps(simde_mm_mul_ps(a2, r), simde_mm_set1_ps(k_atan3));
+    r = simde_mm_add_ps(simde_mm_mul_ps(a2, r), simde_mm_set1_ps(k_atan1));
+    r = simde_mm_mul_ps(a, r);
+
+    // Steep: pi / 2 - r, behind: pi - r, below: -r
+    simde__m128 steep = simde_mm_cmpgt_ps(ay, ax);
+    r = simde_mm_or_ps(simde_mm_and_ps(steep, simde_mm_sub_ps(simde_mm_set1_ps(0.5f * b2_pi), r)),
+                       simde_mm_andnot_ps(steep, r));
+    simde__m128 behind = simde_mm_cmplt_ps(x, simde_mm_setzero_ps());
+    r = simde_mm_or_ps(simde_mm_and_ps(behind, simde_mm_sub_ps(simde_mm_set1_ps(b2_pi), r)),
+                       simde_mm_andnot_ps(behind, r));
+    return simde_mm_xor_ps(r, simde_mm_and_ps(signMask, y));
+}
+
+// tan(x) on [-1, 1] to 1e-6, Pade approximant of degree 5 over 4
+static inline simde__m128 TanSSE2(simde__m128 x)
+{
+    simde__m128 x2 = simde_mm_mul_ps(x, x);
+    simde__m128 x4 = simde_mm_mul_ps(x2, x2);
+    simde__m128 n = simde_mm_add_ps(simde_mm_sub_ps(simde_mm_set1_ps(945.0f), simde_mm_mul_ps(simde_mm_set1_ps(105.0f), x2)), x4);
+    simde__m128 d = simde_mm_add_ps(simde_mm_sub_ps(simde_mm_set1_ps(945.0f), simde_mm_mul_ps(simde_mm_set1_ps(420.0f), x2)),
+                                    simde_mm_mul_ps(simde_mm_set1_ps(15.0f), x4));
+    return simde_mm_div_ps(simde_mm_mul_ps(x, n), d);
+}
+
+void SteerSSE2(SteeringSoA &soa, const SteeringParams &params)
+{
+    assert(soa.padded_count % SteeringSoA::e_blockSize == 0);
+
+    simde__m128 gain = simde_mm_set1_ps(params.speed_gain);
+    simde__m128 maxSpeed = simde_mm_set1_ps(params.max_speed);
+    simde__m128 maxSteering = simde_mm_set1_ps(params.max_steering);
+    simde__m128 minSteering = simde_mm_set1_ps(-params.max_steering);
+    simde__m128 invLegBase = simde_mm_set1_ps(1.0f / params.leg_base);
+    simde__m128 zero = simde_mm_setzero_ps();
+
+    for (int i = 0; i < soa.padded_count; i += 4)
+    {
+        simde__m128 c = simde_mm_loadu_ps(soa.rotation_c.data() + i);
+        simde__m128 s = simde_mm_loadu_ps(soa.rotation_s.data() + i);
+        simde__m128 dx = simde_mm_sub_ps(simde_mm_loadu_ps(soa.waypoint_x.data() + i), simde_mm_loadu_ps(soa.position_x.data() + i));
+        simde__m128 dy = simde_mm_sub_ps(simde_mm_loadu_ps(soa.waypoint_y.data() + i), simde_mm_loadu_ps(soa.position_y.data() + i));
+
+        simde__m128 forward = simde_mm_add_ps(simde_mm_mul_ps(c, dx), simde_mm_mul_ps(s, dy));
+        simde__m128 left = simde_mm_sub_ps(simde_mm_mul_ps(c, dy), simde_mm_mul_ps(s, dx));
+        simde__m128 headingError = Atan2SSE2(left, forward);
+
+        simde__m128 distance = simde_mm_sqrt_ps(simde_mm_add_ps(simde_mm_mul_ps(dx, dx), simde_mm_mul_ps(dy, dy)));
+        simde__m128 speed = simde_mm_min_ps(simde_mm_max_ps(simde_mm_mul_ps(gain, distance), zero), maxSpeed);
+        simde__m128 steering = simde_mm_min_ps(simde_mm_max_ps(headingError, minSteering), maxSteering);
+
+        simde_mm_storeu_ps(soa.linear_x.data() + i, simde_mm_mul_ps(speed, c));
+        simde_mm_storeu_ps(soa.linear_y.data() + i, simde_mm_mul_ps(speed, s));
+        simde_mm_storeu_ps(soa.angular.data() + i, simde_mm_mul_ps(simde_mm_mul_ps(speed, invLegBase), TanSSE2(steering)));
+    }
+}
+
+static inline simde__m256 Atan2AVX2(simde__m256 y, simde__m256 x)
+{
+    simde__m256 signMask = simde_mm256_set1_ps(-0.0f);
+    simde__m256 ax = simde_mm256_andnot_ps(signMask, x);
+    simde__m256 ay = simde_mm256_andnot_ps(signMask, y);
+
+    // Reduce to [0, 1], both zero gives zero like atan2f
+    simde__m256 big = simde_mm256_max_ps(simde_mm256_max_ps(ax, ay), simde_mm256_set1_ps(FLT_MIN));
+    simde__m256 a = simde_mm256_div_ps(simde_mm256_min_ps(ax, ay), big);
+    simde__m256 a2 = simde_mm256_mul_ps(a, a);
+
+    simde__m256 r = simde_mm256_add_ps(simde_mm256_mul_ps(a2, simde_mm256_set1_ps(k_atan11)), simde_mm256_set1_ps(k_atan9));
+    r = simde_mm256_add_ps(simde_mm256_mul_ps(a2, r), simde_mm256_set1_ps(k_atan7));
+    r = simde_mm256_add_ps(simde_mm256_mul_ps(a2, r), simde_mm256_set1_ps(k_atan5));
+    r = simde_mm256_add_ps(simde_mm256_mul_ps(a2, r), simde_mm256_set1_ps(k_atan3));
+    r = simde_mm256_add_ps(simde_mm256_mul_ps(a2, r), simde_mm256_set1_ps(k_atan1));
+    r = simde_mm256_mul_ps(a, r);
+
+    // Steep: pi / 2 - r, behind: pi - r, below: -r
+    r = simde_mm256_blendv_ps(r, simde_mm256_sub_ps(simde_mm256_set1_ps(0.5f * b2_pi), r),
+                              simde_mm256_cmp_ps(ay, ax, SIMDE_CMP_GT_OQ));
+    r = simde_mm256_blendv_ps(r, simde_mm256_sub_ps(simde_mm256_set1_ps(b2_pi), r),
+                              simde_mm256_cmp_ps(x, simde_mm256_setzero_ps(), SIMDE_CMP_LT_OQ));
+    return simde_mm256_xor_ps(r, simde_mm256_and_ps(signMask, y));
+}
+
+// tan(x) on [-1, 1] to 1e-6, Pade approximant of degree 5 over 4
+static inline simde__m256 TanAVX2(simde__m256 x)
+{
+    simde__m256 x2 = simde_mm256_mul_ps(x, x);
+    simde__m256 x4 = simde_mm256_mul_ps(x2, x2);
+    simde__m256 n =
+        simde_mm256_add_ps(simde_mm256_sub_ps(simde_mm256_set1_ps(945.0f), simde_mm256_mul_ps(simde_mm256_set1_ps(105.0f), x2)), x4);
+    simde__m256 d = simde_mm256_add_ps(
+        simde_mm256_sub_ps(simde_mm256_set1_ps(945.0f), simde_mm256_mul_ps(simde_mm256_set1_ps(420.0f), x2)),
+        simde_mm256_mul_ps(simde_mm256_set1_ps(15.0f), x4));
+    return simde_mm256_div_ps(simde_mm256_mul_ps(x, n), d);
+}
+
+void SteerAVX2(SteeringSoA &soa, const SteeringParams &params)
+{
+    assert(soa.padded_count % SteeringSoA::e_blockSize == 0);
+
+    simde__m256 gain = simde_mm256_set1_ps(params.speed_gain);
+    simde__m256 maxSpeed = simde_mm256_set1_ps(params.max_speed);
+    simde__m256 maxSteering = simde_mm256_set1_ps(params.max_steering);
+    simde__m256 minSteering = simde_mm256_set1_ps(-params.max_steering);
+    simde__m256 invLegBase = simde_mm256_set1_ps(1.0f / params.leg_base);
+    simde__m256 zero = simde_mm256_setzero_ps();
+
+    for (int i = 0; i < soa.padded_count; i += 8)
+    {
+        simde__m256 c = simde_mm256_loadu_ps(soa.rotation_c.data() + i);
+        simde__m256 s = simde_mm256_loadu_ps(soa.rotation_s.data() + i);
+        simde__m256 dx =
+            simde_mm256_sub_ps(simde_mm256_loadu_ps(soa.waypoint_x.data() + i), simde_mm256_loadu_ps(soa.position_x.data() + i));
+        simde__m256 dy =
+            simde_mm256_sub_ps(simde_mm256_loadu_ps(soa.waypoint_y.data() + i), simde_mm256_loadu_ps(soa.position_y.data() + i));
+
+        simde__m256 forward = simde_mm256_add_ps(simde_mm256_mul_ps(c, dx), simde_mm256_mul_ps(s, dy));
+        simde__m256 left = simde_mm256_sub_ps(simde_mm256_mul_ps(c, dy), simde_mm256_mul_ps(s, dx));
+        simde__m256 headingError = Atan2AVX2(left, forward);
+
+        simde__m256 distance = simde_mm256_sqrt_ps(simde_mm256_add_ps(simde_mm256_mul_ps(dx, dx), simde_mm256_mul_ps(dy, dy)));
+        simde__m256 speed = simde_mm256_min_ps(simde_mm256_max_ps(simde_mm256_mul_ps(gain, distance), zero), maxSpeed);
+        simde__m256 steering = simde_mm256_min_ps(simde_mm256_max_ps(headingError, minSteering), maxSteering);
+
+        simde_mm256_storeu_ps(soa.linear_x.data() + i, simde_mm256_mul_ps(speed, c));
+        simde_mm256_storeu_ps(soa.linear_y.data() + i, simde_mm256_mul_ps(speed, s));
+        simde_mm256_storeu_ps(soa.angular.data() + i,
+                              simde_mm256_mul_ps(simde_mm256_mul_ps(speed, invLegBase), TanAVX2(steering)));
+    }
+}
+
+void Steer(SteeringSoA &soa, const SteeringParams &params)
+{
+#if defined(SIMDE_X86_AVX2_NATIVE)
+    SteerAVX2(soa, params);
+#else
+    // SSE2 is native on every x64 target and simde maps it to NEON elsewhere
+    SteerSSE2(soa, params);
+#endif
+}
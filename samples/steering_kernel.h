@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+// Gains and limits of the cow controller, see Cow_control_to_point and Cow_move_model
+struct SteeringParams
+{
+    float speed_gain;   // speed per unit of distance to the waypoint
+    float max_speed;
+    float max_steering; // radians
+    float leg_base;     // bicycle model wheel base
+};
+
+// Poses and waypoints of the steered cows in structure of arrays form, so 8 cows
+// are steered at a time. The pose keeps the cosine and sine of the body rotation,
+// the heading needs no trig. Padding lanes sit on their waypoint and come out at rest.
+struct SteeringSoA
+{
+    enum
+    {
+        e_blockSize = 8,
+    };
+
+    void Resize(int count); // pads and resets the padding lanes
+    void Clear();
+
+    std::vector<float> position_x;
+    std::vector<float> position_y;
+    std::vector<float> rotation_c;
+    std::vector<float> rotation_s;
+    std::vector<float> waypoint_x;
+    std::vector<float> waypoint_y;
+
+    // Written by the kernels
+    std::vector<float> linear_x;
+    std::vector<float> linear_y;
+    std::vector<float> angular;
+
+    int count = 0;        // real cows
+    int padded_count = 0; // multiple of e_blockSize
+};
+
+// Each kernel fills the velocities of every lane. The scalar one uses libm and
+// matches the per cow controller. The SIMD ones use a polynomial atan2 (1e-5
+// radians) and a Pade tan (1e-6 over the steering range), their velocities stay
+// within 1e-4 of the scalar ones, in world units and radians per second.
+void SteerScalar(SteeringSoA &soa, const SteeringParams &params);
+void SteerSSE2(SteeringSoA &soa, const SteeringParams &params);
+void SteerAVX2(SteeringSoA &soa, const SteeringParams &params);
+
+// Widest kernel the samples were compiled for
+void Steer(SteeringSoA &soa, const SteeringParams &params);
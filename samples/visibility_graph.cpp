@@ -0,0 +1,252 @@
+#include "visibility_graph.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace
+{
+// Corners move this far out of their box, so edges along a face do not touch it
+const float k_cornerMargin = 0.5f;
+
+bool BoxLess(const b2AABB &a, const b2AABB &b)
+{
+    return std::tie(a.lowerBound.x, a.lowerBound.y, a.upperBound.x, a.upperBound.y) <
+           std::tie(b.lowerBound.x, b.lowerBound.y, b.upperBound.x, b.upperBound.y);
+}
+
+bool EdgeLess(const VisibilityEdge &a, const VisibilityEdge &b)
+{
+    return a.target < b.target;
+}
+} // namespace
+
+VisibilityGraph::VisibilityGraph()
+{
+    m_obstacles = nullptr;
+    m_offsets.assign(1, 0);
+}
+
+void VisibilityGraph::Build(const ObstacleIndex &obstacles, b2Vec2 barn_size)
+{
+    Clear();
+    m_obstacles = &obstacles;
+    m_boxes = obstacles.GetObstacles();
+    FindCorners(obstacles, barn_size);
+
+    int count = GetNodeCount();
+    std::vector<std::vector<VisibilityEdge>> adjacency(count);
+    for (int i = 0; i < count; ++i)
+    {
+        for (int j = i + 1; j < count; ++j)
+        {
+            if (Visible(i, j))
+            {
+                float length = b2Distance(m_positions[i], m_positions[j]);
+                adjacency[i].push_back({j, length});
+                adjacency[j].push_back({i, length});
+            }
+        }
+    }
+    Flatten(adjacency);
+}
+
+int VisibilityGraph::Repair(const ObstacleIndex &obstacles, b2Vec2 barn_size)
+{
+    // Boxes only in the old or only in the new obstacles
+    std::vector<b2AABB> old_boxes = m_boxes;
+    std::vector<b2AABB> new_boxes = obstacles.GetObstacles();
+    std::sort(old_boxes.begin(), old_boxes.end(), BoxLess);
+    std::sort(new_boxes.begin(), new_boxes.end(), BoxLess);
+    std::vector<b2AABB> removed, added;
+    std::set_difference(old_boxes.begin(), old_boxes.end(), new_boxes.begin(), new_boxes.end(),
+                        std::back_inserter(removed), BoxLess);
+    std::set_difference(new_boxes.begin(), new_boxes.end(), old_boxes.begin(), old_boxes.end(),
+                        std::back_inserter(added), BoxLess);
+
+    m_obstacles = &obstacles;
+    m_boxes = obstacles.GetObstacles();
+    if (removed.empty() && added.empty())
+    {
+        return 0;
+    }
+
+    std::vector<b2Vec2> old_positions;
+    std::vector<float> old_turns;
+    std::vector<int> old_offsets;
+    std::vector<VisibilityEdge> old_edges;
+    old_positions.swap(m_positions);
+    old_turns.swap(m_turns);
+    old_offsets.swap(m_offsets);
+    old_edges.swap(m_edges);
+    FindCorners(obstacles, barn_size);
+
+    // Corners both layouts have keep their edges, matched on position and turn
+    std::multimap<std::tuple<float, float, float>, int> old_corners;
+    for (int i = 0; i < int(old_positions.size()); ++i)
+    {
+        old_corners.insert({std::make_tuple(old_positions[i].x, old_positions[i].y, old_turns[i]), i});
+    }
+
+    int count = GetNodeCount();
+    std::vector<int> old_index(count, -1);
+    std::vector<int> new_index(old_positions.size(), -1);
+    std::vector<int> made;
+    for (int i = 0; i < count; ++i)
+    {
+        auto match = old_corners.find(std::make_tuple(m_positions[i].x, m_positions[i].y, m_turns[i]));
+        if (match == old_corners.end())
+        {
+            made.push_back(i);
+            continue;
+        }
+        old_index[i] = match->second;
+        new_index[match->second] = i;
+        old_corners.erase(match); // overlapping boxes can share a corner
+    }
+
+    AABBSoA added_bounds, removed_bounds;
+    added_bounds.Assign(added);
+    removed_bounds.Assign(removed);
+    b2AABB removed_union = removed.empty() ? b2AABB{} : removed[0];
+    for (const b2AABB &box : removed)
+    {
+        removed_union = b2AABB_Union(removed_union, box);
+    }
+
+    std::vector<std::vector<VisibilityEdge>> adjacency(count);
+    for (int i = 0; i < count; ++i)
+    {
+        int a = old_index[i];
+        if (a < 0)
+        {
+            continue;
+        }
+
+        // An old edge was clear of every old box, only the added ones can cut it
+        for (int e = old_offsets[a]; e < old_offsets[a + 1]; ++e)
+        {
+            int j = new_index[old_edges[e].target];
+            if (j < 0 || (added_bounds.count > 0 &&
+                          SegmentHits(MakeSegmentQuery(m_positions[i], m_positions[j]), added_bounds.lower_x.data(),
+                                      added_bounds.lower_y.data(), added_bounds.upper_x.data(),
+                                      added_bounds.upper_y.data(), added_bounds.padded_count)))
+            {
+                continue;
+            }
+            adjacency[i].push_back({j, old_edges[e].length});
+        }
+
+        // Kept corners that a removed box hid from each other, they had no old edge
+        if (removed_bounds.count == 0)
+        {
+            continue;
+        }
+        for (int j = i + 1; j < count; ++j)
+        {
+            // Most pairs are nowhere near the removed boxes
+            b2Vec2 lower = b2Min(m_positions[i], m_positions[j]);
+            b2Vec2 upper = b2Max(m_positions[i], m_positions[j]);
+            if (lower.x > removed_union.upperBound.x || lower.y > removed_union.upperBound.y ||
+                upper.x < removed_union.lowerBound.x || upper.y < removed_union.lowerBound.y)
+            {
+                continue;
+            }
+
+            b2Vec2 direction = m_positions[j] - m_positions[i];
+            if (old_index[j] < 0 || !IsTangent(i, direction) || !IsTangent(j, direction) ||
+                !SegmentHits(MakeSegmentQuery(m_positions[i], m_positions[j]), removed_bounds.lower_x.data(),
+                             removed_bounds.lower_y.data(), removed_bounds.upper_x.data(),
+                             removed_bounds.upper_y.data(), removed_bounds.padded_count) ||
+                obstacles.SegmentBlocked(m_positions[i], m_positions[j]))
+            {
+                continue;
+            }
+
+            float length = b2Length(direction);
+            adjacency[i].push_back({j, length});
+            adjacency[j].push_back({i, length});
+        }
+    }
+
+    // Corners the edit made against every corner, pairs of made corners once
+    for (int i : made)
+    {
+        for (int j = 0; j < count; ++j)
+        {
+            if (j == i || (old_index[j] < 0 && j < i) || !Visible(i, j))
+            {
+                continue;
+            }
+
+            float length = b2Distance(m_positions[i], m_positions[j]);
+            adjacency[i].push_back({j, length});
+            adjacency[j].push_back({i, length});
+        }
+    }
+
+    // Same edge order as Build, so the planner breaks ties the same way
+    for (std::vector<VisibilityEdge> &edges : adjacency)
+    {
+        std::sort(edges.begin(), edges.end(), EdgeLess);
+    }
+    Flatten(adjacency);
+    return int(made.size());
+}
+
+void VisibilityGraph::Clear()
+{
+    m_obstacles = nullptr;
+    m_boxes.clear();
+    m_positions.clear();
+    m_turns.clear();
+    m_offsets.assign(1, 0);
+    m_edges.clear();
+}
+
+void VisibilityGraph::FindCorners(const ObstacleIndex &obstacles, b2Vec2 barn_size)
+{
+    for (const b2AABB &box : obstacles.GetObstacles())
+    {
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            float sx = (corner & 1) ? 1.0f : -1.0f;
+            float sy = (corner & 2) ? 1.0f : -1.0f;
+            b2Vec2 position = {sx > 0.0f ? box.upperBound.x + k_cornerMargin : box.lowerBound.x - k_cornerMargin,
+                               sy > 0.0f ? box.upperBound.y + k_cornerMargin : box.lowerBound.y - k_cornerMargin};
+
+            // Merged boxes overlap, corners inside a neighbour or past the walls are useless
+            if (position.x < 0.0f || position.y < 0.0f || position.x > barn_size.x || position.y > barn_size.y ||
+                obstacles.PointBlocked(position, 0.0f))
+            {
+                continue;
+            }
+
+            m_positions.push_back(position);
+            m_turns.push_back(sx * sy);
+        }
+    }
+}
+
+bool VisibilityGraph::Visible(int a, int b) const
+{
+    b2Vec2 direction = m_positions[b] - m_positions[a];
+    return IsTangent(a, direction) && IsTangent(b, direction) &&
+           !m_obstacles->SegmentBlocked(m_positions[a], m_positions[b]);
+}
+
+void VisibilityGraph::Flatten(std::vector<std::vector<VisibilityEdge>> &adjacency)
+{
+    // Flattened so a query walks one array
+    int count = int(adjacency.size());
+    m_offsets.resize(count + 1);
+    m_offsets[0] = 0;
+    m_edges.clear();
+    for (int i = 0; i < count; ++i)
+    {
+        m_offsets[i + 1] = m_offsets[i] + int(adjacency[i].size());
+        m_edges.insert(m_edges.end(), adjacency[i].begin(), adjacency[i].end());
+    }
+}
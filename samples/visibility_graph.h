@@ -0,0 +1,56 @@
+#pragma once
+
+#include "obstacle_index.h"
+
+#include "box2d/types.h"
+
+#include <vector>
+
+struct VisibilityEdge
+{
+    int target;
+    float length;
+};
+
+// Corners of the inflated obstacles and the free straight lines between them,
+// built once per layout. A shortest path around boxes only bends at their corners,
+// so A* over this small graph gives optimal any angle paths, see VisibilityPlanner.
+// Corners sit just outside their box, and only edges that pass a corner without
+// turning into its box are kept, the others can never be on a shortest path.
+class VisibilityGraph
+{
+public:
+    VisibilityGraph();
+
+    // obstacles must outlive the graph, corners outside the barn are dropped
+    void Build(const ObstacleIndex &obstacles, b2Vec2 barn_size);
+    void Clear();
+
+    // Same graph as Build after obstacles was rebuilt for an edit. Only the corners of
+    // changed boxes are tested against every corner, kept edges are only tested against
+    // the added boxes. Returns the corners the edit made.
+    int Repair(const ObstacleIndex &obstacles, b2Vec2 barn_size);
+
+    // True if a path leaving the corner toward direction does not cut into its box
+    bool IsTangent(int node, b2Vec2 direction) const { return direction.x * direction.y * m_turns[node] <= 0.0f; }
+
+    int GetNodeCount() const { return int(m_positions.size()); }
+    int GetEdgeCount() const { return int(m_edges.size()); }
+    b2Vec2 GetPosition(int node) const { return m_positions[node]; }
+    int EdgeBegin(int node) const { return m_offsets[node]; }
+    int EdgeEnd(int node) const { return m_offsets[node + 1]; }
+    const VisibilityEdge &GetEdge(int edge) const { return m_edges[edge]; }
+    const ObstacleIndex *GetObstacles() const { return m_obstacles; }
+
+private:
+    void FindCorners(const ObstacleIndex &obstacles, b2Vec2 barn_size);
+    bool Visible(int a, int b) const;
+    void Flatten(std::vector<std::vector<VisibilityEdge>> &adjacency);
+
+    const ObstacleIndex *m_obstacles;
+    std::vector<b2AABB> m_boxes;       // the obstacles the graph was made for, Repair diffs against them
+    std::vector<b2Vec2> m_positions;
+    std::vector<float> m_turns;        // product of the outward signs of the corner, +1 or -1
+    std::vector<int> m_offsets;        // edges of node i are m_edges[m_offsets[i], m_offsets[i + 1])
+    std::vector<VisibilityEdge> m_edges;
+};
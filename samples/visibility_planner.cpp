@@ -0,0 +1,273 @@
+#include "visibility_planner.h"
+
+#include "box2d/math_functions.h"
+
+#include <algorithm>
+#include <float.h>
+
+namespace
+{
+// Points stepped out of a box stop this far past its face
+const float k_stepOutMargin = 0.5f;
+} // namespace
+
+VisibilityPlanner::VisibilityPlanner()
+{
+    m_graph = nullptr;
+    m_obstacles = nullptr;
+    m_startNode = 0;
+    m_goalNode = 0;
+    m_from = b2Vec2_zero;
+    m_to = b2Vec2_zero;
+    m_stamp = 0;
+}
+
+void VisibilityPlanner::Prepare(int node_count)
+{
+    if (node_count > int(m_costs.size()))
+    {
+        m_costs.resize(node_count);
+        m_parents.resize(node_count);
+        m_seenStamps.resize(node_count, m_stamp);
+        m_closedStamps.resize(node_count, m_stamp);
+    }
+
+    // Bumping the stamp forgets the previous query without touching the nodes
+    ++m_stamp;
+    m_open.clear();
+}
+
+float VisibilityPlanner::Heuristic(b2Vec2 point) const
+{
+    // The closest goal, an area has at most six sides
+    float dist = FLT_MAX;
+    for (b2Vec2 goal : m_goals)
+    {
+        dist = b2MinFloat(dist, b2Distance(point, goal));
+    }
+    return dist;
+}
+
+bool VisibilityPlanner::Push(int node, int parent, float g)
+{
+    if (m_closedStamps[node] == m_stamp || (m_seenStamps[node] == m_stamp && m_costs[node] <= g))
+    {
+        return false;
+    }
+
+    m_costs[node] = g;
+    m_parents[node] = parent;
+    m_seenStamps[node] = m_stamp;
+
+    float h = 0.0f;
+    if (node != m_goalNode)
+    {
+        h = Heuristic(node < m_startNode ? m_graph->GetPosition(node) : m_from);
+    }
+    m_open.push_back({g + h, g, node});
+    std::push_heap(m_open.begin(), m_open.end(),
+                   [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+    return true;
+}
+
+void VisibilityPlanner::PushGoal(int node, b2Vec2 goal, float g)
+{
+    if (Push(m_goalNode, node, g))
+    {
+        m_to = goal;
+    }
+}
+
+b2Vec2 VisibilityPlanner::StepOut(b2Vec2 point) const
+{
+    // Out through the closest face, a few rounds in case that face touches another box
+    for (int round = 0; round < 4 && m_obstacles->PointBlocked(point, 0.0f); ++round)
+    {
+        for (const b2AABB &box : m_obstacles->GetObstacles())
+        {
+            if (point.x < box.lowerBound.x || point.x > box.upperBound.x || point.y < box.lowerBound.y ||
+                point.y > box.upperBound.y)
+            {
+                continue;
+            }
+
+            float left = point.x - box.lowerBound.x;
+            float right = box.upperBound.x - point.x;
+            float down = point.y - box.lowerBound.y;
+            float up = box.upperBound.y - point.y;
+            float closest = b2MinFloat(b2MinFloat(left, right), b2MinFloat(down, up));
+            if (closest == left)
+            {
+                point.x = box.lowerBound.x - k_stepOutMargin;
+            }
+            else if (closest == right)
+            {
+                point.x = box.upperBound.x + k_stepOutMargin;
+            }
+            else if (closest == down)
+            {
+                point.y = box.lowerBound.y - k_stepOutMargin;
+            }
+            else
+            {
+                point.y = box.upperBound.y + k_stepOutMargin;
+            }
+        }
+    }
+    return point;
+}
+
+PlanResult VisibilityPlanner::FindPath(b2Vec2 start, const std::vector<b2Vec2> &goals, const VisibilityGraph &graph,
+                                       const PlanBudget &budget)
+{
+    PlanResult result;
+    m_graph = &graph;
+    m_obstacles = graph.GetObstacles();
+    if (m_obstacles == nullptr)
+    {
+        return result;
+    }
+
+    m_goals.clear();
+    for (b2Vec2 goal : goals)
+    {
+        if (!m_obstacles->PointBlocked(goal, 0.0f))
+        {
+            m_goals.push_back(goal);
+        }
+    }
+    if (m_goals.empty())
+    {
+        return result;
+    }
+
+    m_from = StepOut(start);
+
+    m_startNode = graph.GetNodeCount();
+    m_goalNode = m_startNode + 1;
+    Prepare(m_goalNode + 1);
+
+    // Most trips across an open barn need no corner at all, the closest goal in sight ends them
+    float direct = FLT_MAX;
+    for (b2Vec2 goal : m_goals)
+    {
+        float dist = b2Distance(m_from, goal);
+        if (dist < direct && !m_obstacles->SegmentBlocked(m_from, goal))
+        {
+            direct = dist;
+            m_to = goal;
+        }
+    }
+    if (direct < FLT_MAX)
+    {
+        m_parents[m_goalNode] = m_startNode;
+        m_parents[m_startNode] = -1;
+        result.status = plan_found;
+        result.iterations = 1;
+        BuildPath(m_goalNode, result.path);
+        if (m_from != start)
+        {
+            result.path.insert(result.path.begin(), start);
+        }
+        return result;
+    }
+
+    Push(m_startNode, -1, 0.0f);
+    int closest = m_startNode;
+    float closestDist = Heuristic(m_from);
+    bool exhausted = true;
+
+    b2Timer timer = b2CreateTimer();
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(),
+                      [](const OpenNode &a, const OpenNode &b) { return OpenLess(a.f, a.g, b.f, b.g); });
+        OpenNode open = m_open.back();
+        m_open.pop_back();
+
+        if (m_closedStamps[open.node] == m_stamp || open.g > m_costs[open.node])
+        {
+            continue;
+        }
+        m_closedStamps[open.node] = m_stamp;
+        ++result.iterations;
+
+        if (open.node == m_goalNode)
+        {
+            result.status = plan_found;
+            BuildPath(open.node, result.path);
+            break;
+        }
+
+        if (open.node == m_startNode)
+        {
+            // The start sees the corners it is not hidden from, tested once per query
+            for (int node = 0; node < m_startNode; ++node)
+            {
+                b2Vec2 position = graph.GetPosition(node);
+                if (graph.IsTangent(node, m_from - position) && !m_obstacles->SegmentBlocked(m_from, position))
+                {
+                    Push(node, m_startNode, b2Distance(m_from, position));
+                }
+            }
+        }
+        else
+        {
+            float dist = open.f - open.g;
+            if (dist < closestDist)
+            {
+                closest = open.node;
+                closestDist = dist;
+            }
+
+            for (int edge = graph.EdgeBegin(open.node); edge < graph.EdgeEnd(open.node); ++edge)
+            {
+                const VisibilityEdge &e = graph.GetEdge(edge);
+                Push(e.target, open.node, open.g + e.length);
+            }
+
+            // Every goal in sight is a way to finish, only the ones that would beat the best so far are tested
+            b2Vec2 position = graph.GetPosition(open.node);
+            for (b2Vec2 goal : m_goals)
+            {
+                float g = open.g + b2Distance(position, goal);
+                bool better = m_seenStamps[m_goalNode] != m_stamp || g < m_costs[m_goalNode];
+                if (better && graph.IsTangent(open.node, goal - position) && !m_obstacles->SegmentBlocked(position, goal))
+                {
+                    PushGoal(open.node, goal, g);
+                }
+            }
+        }
+
+        // Expansions test segments, so the clock is read more often than in the grid planners
+        if (result.iterations >= budget.max_iterations ||
+            ((result.iterations & 15) == 0 && budget.max_milliseconds > 0.0f &&
+             b2GetMilliseconds(&timer) > budget.max_milliseconds))
+        {
+            exhausted = false;
+            break;
+        }
+    }
+
+    if (result.status != plan_found && !exhausted && closest != m_startNode)
+    {
+        result.status = plan_partial;
+        BuildPath(closest, result.path);
+    }
+
+    if (!result.path.empty() && m_from != start)
+    {
+        result.path.insert(result.path.begin(), start);
+    }
+    return result;
+}
+
+void VisibilityPlanner::BuildPath(int node, std::vector<b2Vec2> &path) const
+{
+    path.clear();
+    for (; node >= 0; node = m_parents[node])
+    {
+        path.push_back(node < m_startNode ? m_graph->GetPosition(node) : (node == m_startNode ? m_from : m_to));
+    }
+    std::reverse(path.begin(), path.end());
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "planner.h"
+#include "visibility_graph.h"
+
+#include "box2d/types.h"
+
+#include <vector>
+
+// A* with the straight line heuristic over a VisibilityGraph. The start and goal
+// join the graph for one query only. The goals are free points, the centres of the
+// free cells beside a functional area, and the plan ends at whichever one it sees
+// first on the shortest route. A start pushed into the clearance band first steps
+// straight out.
+//
+// Scratch arrays are stamped, one planner per thread plans any number of queries
+// on a graph without allocating.
+class VisibilityPlanner
+{
+public:
+    VisibilityPlanner();
+
+    PlanResult FindPath(b2Vec2 start, const std::vector<b2Vec2> &goals, const VisibilityGraph &graph,
+                        const PlanBudget &budget);
+
+private:
+    struct OpenNode
+    {
+        float f;
+        float g;
+        int node;
+    };
+
+    void Prepare(int node_count);
+    float Heuristic(b2Vec2 point) const;
+    bool Push(int node, int parent, float g);
+    void PushGoal(int node, b2Vec2 goal, float g);
+    b2Vec2 StepOut(b2Vec2 point) const;
+    void BuildPath(int node, std::vector<b2Vec2> &path) const;
+
+    const VisibilityGraph *m_graph;
+    const ObstacleIndex *m_obstacles;
+    int m_startNode; // the two query nodes follow the corners
+    int m_goalNode;
+    b2Vec2 m_from;
+    b2Vec2 m_to; // goal the best push to the goal node came from
+    int m_stamp;
+
+    std::vector<b2Vec2> m_goals; // the free goals of the query
+    std::vector<float> m_costs;
+    std::vector<int> m_parents;
+    std::vector<int> m_seenStamps;
+    std::vector<int> m_closedStamps;
+    std::vector<OpenNode> m_open; // binary heap, stale entries are skipped on pop
+};
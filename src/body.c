@@ -789,6 +789,97 @@ void b2Body_SetAngularVelocity( b2BodyId bodyId, float angularVelocity )
 	state->angularVelocity = angularVelocity;
 }
 
+void b2Body_GetTransforms( const b2BodyId* bodyIds, b2Transform* transforms, int count )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	b2World* world = b2GetWorld( bodyIds[0].world0 );
+	b2SolverSet* sets = world->solverSetArray;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( bodyIds[i].world0 == world->worldId );
+		b2Body* body = b2GetBodyFullId( world, bodyIds[i] );
+		b2CheckIndex( sets, body->setIndex );
+		b2SolverSet* set = sets + body->setIndex;
+		B2_ASSERT( 0 <= body->localIndex && body->localIndex < set->sims.count );
+		transforms[i] = set->sims.data[body->localIndex].transform;
+	}
+}
+
+void b2Body_GetVelocities( const b2BodyId* bodyIds, b2Vec2* linearVelocities, float* angularVelocities, int count )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	b2World* world = b2GetWorld( bodyIds[0].world0 );
+	b2SolverSet* awakeSet = world->solverSetArray + b2_awakeSet;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( bodyIds[i].world0 == world->worldId );
+		b2Body* body = b2GetBodyFullId( world, bodyIds[i] );
+
+		b2Vec2 linearVelocity = b2Vec2_zero;
+		float angularVelocity = 0.0f;
+		if ( body->setIndex == b2_awakeSet )
+		{
+			B2_ASSERT( 0 <= body->localIndex && body->localIndex < awakeSet->states.count );
+			b2BodyState* state = awakeSet->states.data + body->localIndex;
+			linearVelocity = state->linearVelocity;
+			angularVelocity = state->angularVelocity;
+		}
+
+		if ( linearVelocities != NULL )
+		{
+			linearVelocities[i] = linearVelocity;
+		}
+
+		if ( angularVelocities != NULL )
+		{
+			angularVelocities[i] = angularVelocity;
+		}
+	}
+}
+
+void b2Body_SetVelocities( const b2BodyId* bodyIds, const b2Vec2* linearVelocities, const float* angularVelocities, int count )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	b2World* world = b2GetWorld( bodyIds[0].world0 );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( bodyIds[i].world0 == world->worldId );
+		b2Body* body = b2GetBodyFullId( world, bodyIds[i] );
+		b2Vec2 linearVelocity = linearVelocities[i];
+		float angularVelocity = angularVelocities[i];
+
+		if ( b2LengthSquared( linearVelocity ) > 0.0f || angularVelocity != 0.0f )
+		{
+			b2WakeBody( world, body );
+		}
+
+		// Waking moves bodies between sets, so look the awake set up after it
+		if ( body->setIndex == b2_awakeSet )
+		{
+			b2SolverSet* awakeSet = world->solverSetArray + b2_awakeSet;
+			B2_ASSERT( 0 <= body->localIndex && body->localIndex < awakeSet->states.count );
+			b2BodyState* state = awakeSet->states.data + body->localIndex;
+			state->linearVelocity = linearVelocity;
+			state->angularVelocity = angularVelocity;
+		}
+	}
+}
+
 void b2Body_ApplyForce( b2BodyId bodyId, b2Vec2 force, b2Vec2 point, bool wake )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
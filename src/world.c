@@ -1675,6 +1675,11 @@ b2Counters b2World_GetCounters( b2WorldId worldId )
 	s.jointCount = b2GetIdCount( &world->jointIdPool );
 	s.islandCount = b2GetIdCount( &world->islandIdPool );
 
+	// Bodies and contacts the step updates, touching awake contacts live in the constraint graph
+	b2SolverSet* awakeSet = world->solverSetArray + b2_awakeSet;
+	s.awakeBodyCount = awakeSet->sims.count;
+	s.awakeContactCount = awakeSet->contacts.count;
+
 	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
 	s.staticTreeHeight = b2DynamicTree_GetHeight( staticTree );
 
@@ -1689,6 +1694,7 @@ b2Counters b2World_GetCounters( b2WorldId worldId )
 	for ( int i = 0; i < b2_graphColorCount; ++i )
 	{
 		s.colorCounts[i] = world->constraintGraph.colors[i].contacts.count + world->constraintGraph.colors[i].joints.count;
+		s.awakeContactCount += world->constraintGraph.colors[i].contacts.count;
 	}
 	return s;
 }
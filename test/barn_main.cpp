@@ -0,0 +1,18 @@
+#include "test_macros.h"
+
+extern int HerdTest( void );
+extern int PlannerTest( void );
+
+int main( void )
+{
+	printf( "Starting barn unit tests\n" );
+	printf( "======================================\n" );
+
+	RUN_TEST( PlannerTest );
+	RUN_TEST( HerdTest );
+
+	printf( "======================================\n" );
+	printf( "All barn tests passed!\n" );
+
+	return 0;
+}
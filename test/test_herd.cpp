@@ -0,0 +1,221 @@
+#include "herd.h"
+#include "random_stream.h"
+#include "steering_kernel.h"
+#include "test_macros.h"
+
+#include "box2d/box2d.h"
+#include "box2d/collision.h"
+#include "box2d/math_functions.h"
+
+// Distance between the polygon cores of two cows, their rounded bodies touch at twice the corner radius
+static float CoreDistance( b2BodyId bodyIdA, b2BodyId bodyIdB )
+{
+	b2ShapeId shapeIdA, shapeIdB;
+	b2Body_GetShapes( bodyIdA, &shapeIdA, 1 );
+	b2Body_GetShapes( bodyIdB, &shapeIdB, 1 );
+	b2Polygon polygonA = b2Shape_GetPolygon( shapeIdA );
+	b2Polygon polygonB = b2Shape_GetPolygon( shapeIdB );
+
+	b2DistanceInput input;
+	input.proxyA = b2MakeProxy( polygonA.vertices, polygonA.count, 0.0f );
+	input.proxyB = b2MakeProxy( polygonB.vertices, polygonB.count, 0.0f );
+	input.transformA = b2Body_GetTransform( bodyIdA );
+	input.transformB = b2Body_GetTransform( bodyIdB );
+	input.useRadii = false;
+
+	b2DistanceCache cache = { 0 };
+	b2DistanceOutput output = b2ShapeDistance( &cache, &input, NULL, 0 );
+	return output.distance;
+}
+
+// A cow walking into a resting one pushes it, it never walks through it
+static int RestingCowCollides( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	Herd herd;
+	herd.Create( 2 );
+	for ( int i = 0; i < 2; ++i )
+	{
+		Cow& cow = herd.GetCow( i );
+		cow.SeedRandom( uint64_t( i ) );
+		cow.Spawn( worldId, 60.0f * i, 0.0f, 0.0f, 0.05f, 0.0f, 0.0f, i + 1, nullptr );
+	}
+
+	b2BodyId mover = herd.body_ids[0];
+	b2BodyId resting = herd.body_ids[1];
+	herd.Deactivate( 1 );
+	ENSURE( herd.IsActive( 1 ) == false );
+	ENSURE( b2Body_IsAwake( resting ) == false );
+
+	// Drive the mover into the side of the resting cow for two seconds
+	float minDistance = CoreDistance( mover, resting );
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2Body_SetLinearVelocity( mover, { float( cow_max_speed ), 0.0f } );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		minDistance = b2MinFloat( minDistance, CoreDistance( mover, resting ) );
+	}
+
+	float touching = 2.0f * cow_corner_radius;
+	ENSURE( minDistance > touching - 1.0f );
+	ENSURE( b2Body_GetPosition( resting ).x > 60.0f );
+
+	// Waking puts the cow back with the rest of the herd
+	herd.Activate( 1 );
+	ENSURE( b2Body_IsAwake( resting ) == true );
+	b2ShapeId shapeId;
+	b2Body_GetShapes( resting, &shapeId, 1 );
+	ENSURE( b2Shape_GetFilter( shapeId ).categoryBits == b2DefaultFilter().categoryBits );
+
+	herd.Clear();
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// With no area for its next activity a cow waits and tries again, like after a failed plan
+static int NoAreaForActivity( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	std::vector<SampleFunctionalArea> layout;
+	ActivitySampler activities;
+	activities.Build( layout );
+
+	Herd herd;
+	herd.Create( 1 );
+	Cow& cow = herd.GetCow( 0 );
+	cow.SeedRandom( 3 );
+	cow.Spawn( worldId, 0.0f, 0.0f, 0.0f, 0.05f, 0.0f, 0.0f, 1, nullptr );
+	cow.cow_layout = &layout;
+	cow.cow_activities = &activities;
+
+	herd.FetchPoses();
+	cow.Routine( herd.GetPose( 0 ) );
+	ENSURE( cow.State() == cow_idling );
+	ENSURE( cow.IdleSteps() == cow_retry_steps );
+
+	for ( int i = 0; i < cow_retry_steps; ++i )
+	{
+		cow.Routine( herd.GetPose( 0 ) );
+	}
+	ENSURE( cow.State() == cow_starting );
+
+	herd.Clear();
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Partial plans toward a walled in target stop closing in, the cow gives up on it
+static int WalledInTarget( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	Herd herd;
+	herd.Create( 1 );
+	Cow& cow = herd.GetCow( 0 );
+	cow.SeedRandom( 5 );
+	cow.Spawn( worldId, 0.0f, 0.0f, 0.0f, 0.05f, 0.0f, 0.0f, 1, nullptr );
+	cow.Target() = { 240.0f, 0.0f };
+
+	// Each plan gets a cell closer, the cow keeps walking
+	for ( int i = 0; i < 2 * cow_max_failed_plans; ++i )
+	{
+		PlanResult result;
+		result.status = plan_partial;
+		result.path = { { 0.0f, 0.0f }, { 24.0f * ( i + 1 ), 0.0f } };
+		cow.ApplyPlan( engine_rrt, result );
+		ENSURE( cow.State() == cow_traslating );
+	}
+
+	// Then the tree stops short of the wall every time
+	for ( int i = 0; i < cow_max_failed_plans; ++i )
+	{
+		ENSURE( cow.State() == cow_traslating );
+		PlanResult result;
+		result.status = plan_partial;
+		result.path = { { 0.0f, 0.0f }, { 150.0f, 0.0f } };
+		cow.ApplyPlan( engine_rrt, result );
+	}
+	ENSURE( cow.State() == cow_idling );
+	ENSURE( cow.IdleSteps() == cow_retry_steps );
+
+	herd.Clear();
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// The SIMD kernels stay within 1e-4 of the scalar one on every lane, the padding lanes come out at rest
+static int SteeringKernels( void )
+{
+	SteeringParams params;
+	params.speed_gain = cow_params.k_v;
+	params.max_speed = float( cow_max_speed );
+	params.max_steering = float( cow_max_steering_angle );
+	params.leg_base = float( cow_leg_base );
+
+	typedef void SteerFcn( SteeringSoA&, const SteeringParams& );
+	SteerFcn* kernels[2] = { SteerSSE2, SteerAVX2 };
+
+	RandomStream random( 23 );
+	SteeringSoA scalar;
+	for ( int round = 0; round < 200; ++round )
+	{
+		// Counts that leave anywhere from zero to seven padding lanes
+		int count = 1 + random.NextInt( 40 );
+		scalar.Resize( count );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Rot rotation = b2MakeRot( random.NextFloat( -b2_pi, b2_pi ) );
+			scalar.position_x[i] = random.NextFloat( 0.0f, 2400.0f );
+			scalar.position_y[i] = random.NextFloat( 0.0f, 2400.0f );
+			scalar.rotation_c[i] = rotation.c;
+			scalar.rotation_s[i] = rotation.s;
+
+			// Waypoints on every side, near enough for some to stay under the speed limit, a few reached
+			b2Rot direction = b2MakeRot( random.NextFloat( -b2_pi, b2_pi ) );
+			float reach = random.NextInt( 8 ) == 0 ? 0.0f : random.NextFloat( 0.0f, 100.0f );
+			scalar.waypoint_x[i] = scalar.position_x[i] + reach * direction.c;
+			scalar.waypoint_y[i] = scalar.position_y[i] + reach * direction.s;
+		}
+
+		SteerScalar( scalar, params );
+		for ( int i = count; i < scalar.padded_count; ++i )
+		{
+			ENSURE( scalar.linear_x[i] == 0.0f && scalar.linear_y[i] == 0.0f && scalar.angular[i] == 0.0f );
+		}
+
+		for ( SteerFcn* kernel : kernels )
+		{
+			SteeringSoA simd = scalar;
+			kernel( simd, params );
+			for ( int i = 0; i < scalar.padded_count; ++i )
+			{
+				ENSURE_SMALL( simd.linear_x[i] - scalar.linear_x[i], 1e-4f );
+				ENSURE_SMALL( simd.linear_y[i] - scalar.linear_y[i], 1e-4f );
+				ENSURE_SMALL( simd.angular[i] - scalar.angular[i], 1e-4f );
+			}
+		}
+	}
+
+	return 0;
+}
+
+int HerdTest( void )
+{
+	RUN_SUBTEST( RestingCowCollides );
+	RUN_SUBTEST( NoAreaForActivity );
+	RUN_SUBTEST( WalledInTarget );
+	RUN_SUBTEST( SteeringKernels );
+
+	return 0;
+}
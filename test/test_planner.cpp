@@ -0,0 +1,342 @@
+#include "grid_planner.h"
+#include "hierarchical_planner.h"
+#include "mapmaker.h"
+#include "random_stream.h"
+#include "rrt.h"
+#include "test_macros.h"
+#include "visibility_planner.h"
+
+#include "box2d/math_functions.h"
+
+#include <vector>
+
+// A barn five cells wide with a full row of areas below and above a one cell aisle
+static void MakeAisleMap( MapMaker& map, float clearance )
+{
+	map.corner_layout = { 5, 3 };
+	map.clearance = clearance;
+	for ( int x = 0; x < 5; ++x )
+	{
+		for ( int y = 0; y < 3; y += 2 )
+		{
+			SampleFunctionalArea area;
+			area.type = 0;
+			area.orientation = 0;
+			area.x = float( x );
+			area.y = float( y );
+			map.layout.push_back( area );
+			map.cow_aabbs.push_back( map.AreaAABB( area ) );
+		}
+	}
+	map.CreateCowMap();
+	map.CreateGridMap();
+	map.CreateVisibilityGraph();
+}
+
+// The clearance keeps a strip of a one cell aisle free, so the planners get through it
+static int OneCellAisle( void )
+{
+	MapMaker map;
+	MakeAisleMap( map, 11.0f );
+
+	b2Vec2 start = { 12.0f, 36.0f };
+	b2Vec2 goal = { 108.0f, 36.0f };
+	ENSURE( map.obstacle_index.PointBlocked( start, 0.0f ) == false );
+	ENSURE( map.obstacle_index.SegmentBlocked( start, goal ) == false );
+
+	PlanBudget budget;
+	budget.max_milliseconds = 0.0f;
+	budget.max_iterations = 5000;
+
+	RRT rrt;
+	rrt.random.Seed( 7 );
+	PlanResult result = rrt.FindPath( start, goal, &map.obstacle_index, { 120.0f, 72.0f }, 24.0f, 24.0f, budget );
+	ENSURE( result.status == plan_found );
+
+	VisibilityPlanner visibility;
+	result = visibility.FindPath( start, { goal }, map.visibility, budget );
+	ENSURE( result.status == plan_found );
+
+	// Half a cell on each side closes the aisle
+	MapMaker closed;
+	MakeAisleMap( closed, 12.0f );
+	ENSURE( closed.obstacle_index.SegmentBlocked( start, goal ) == true );
+
+	return 0;
+}
+
+// Rewiring moves whole subtrees, every node still knows its exact length from the root
+static int StarCosts( void )
+{
+	// An open barn ten cells wide with a block of areas in the middle
+	MapMaker map;
+	map.corner_layout = { 10, 10 };
+	map.clearance = 11.0f;
+	for ( int x = 4; x < 6; ++x )
+	{
+		for ( int y = 2; y < 8; ++y )
+		{
+			SampleFunctionalArea area = { 0, 0, float( x ), float( y ) };
+			map.layout.push_back( area );
+			map.cow_aabbs.push_back( map.AreaAABB( area ) );
+		}
+	}
+	map.CreateCowMap();
+
+	PlanBudget budget;
+	budget.max_milliseconds = 0.0f;
+	budget.max_iterations = 3000;
+
+	RRT rrt;
+	rrt.mode = rrt_star;
+	rrt.random.Seed( 11 );
+	PlanResult result = rrt.FindPath( { 24.0f, 120.0f }, { 216.0f, 120.0f }, &map.obstacle_index, { 240.0f, 240.0f },
+									  24.0f, 24.0f, budget );
+	ENSURE( result.status == plan_found );
+	result = rrt.RefineStar( budget );
+	ENSURE( result.status == plan_found );
+
+	for ( Node* node : rrt.nodes )
+	{
+		float length = 0.0f;
+		for ( Node* child = node; child->parent != nullptr; child = child->parent )
+		{
+			length += b2Distance( child->position, child->parent->position );
+		}
+		ENSURE_SMALL( node->cost - length, 1e-3f * ( 1.0f + length ) );
+	}
+
+	return 0;
+}
+
+// A barn of single cell areas on about a quarter of the cells, with every map built
+static void MakeRandomMap( MapMaker& map, int size, RandomStream& random )
+{
+	map.corner_layout = { size, size };
+	map.clearance = 11.0f;
+	for ( int x = 0; x < size; ++x )
+	{
+		for ( int y = 0; y < size; ++y )
+		{
+			if ( random.NextInt( 4 ) == 0 )
+			{
+				SampleFunctionalArea area = { random.NextInt( 7 ), 0, float( x ), float( y ) };
+				map.layout.push_back( area );
+				map.cow_aabbs.push_back( map.AreaAABB( area ) );
+			}
+		}
+	}
+	map.CreateCowMap();
+	map.CreateGridMap();
+	map.CreateFlowFields();
+	map.CreateChunkGraph();
+	map.CreateVisibilityGraph();
+}
+
+// Removes a few areas and drops a few on free cells, then patches the maps like Barn::EditLayout
+static void EditRandomMap( MapMaker& map, RandomStream& random )
+{
+	std::vector<SampleFunctionalArea> layout = map.layout;
+	for ( int i = 0; i < 3 && layout.empty() == false; ++i )
+	{
+		layout.erase( layout.begin() + random.NextInt( int( layout.size() ) ) );
+	}
+	for ( int i = 0; i < 3; ++i )
+	{
+		int x = random.NextInt( map.corner_layout.first );
+		int y = random.NextInt( map.corner_layout.second );
+		if ( map.grid_map[x][y] == false )
+		{
+			layout.push_back( { random.NextInt( 7 ), 0, float( x ), float( y ) } );
+		}
+	}
+
+	map.EditLayout( layout );
+	map.cow_aabbs.clear();
+	for ( const SampleFunctionalArea& area : map.layout )
+	{
+		map.cow_aabbs.push_back( map.AreaAABB( area ) );
+	}
+	map.CreateCowMap();
+}
+
+// After every edit the repaired visibility graph is the graph a fresh build makes
+static int VisibilityRepair( void )
+{
+	RandomStream random( 17 );
+	MapMaker map;
+	MakeRandomMap( map, 20, random );
+
+	for ( int edit = 0; edit < 40; ++edit )
+	{
+		EditRandomMap( map, random );
+		map.RepairVisibilityGraph();
+
+		VisibilityGraph fresh;
+		fresh.Build( map.obstacle_index, { 20 * 24.0f, 20 * 24.0f } );
+
+		const VisibilityGraph& repaired = map.visibility;
+		ENSURE( repaired.GetNodeCount() == fresh.GetNodeCount() );
+		ENSURE( repaired.GetEdgeCount() == fresh.GetEdgeCount() );
+		for ( int i = 0; i < fresh.GetNodeCount(); ++i )
+		{
+			ENSURE( repaired.GetPosition( i ).x == fresh.GetPosition( i ).x );
+			ENSURE( repaired.GetPosition( i ).y == fresh.GetPosition( i ).y );
+			ENSURE( repaired.EdgeBegin( i ) == fresh.EdgeBegin( i ) );
+		}
+		for ( int e = 0; e < fresh.GetEdgeCount(); ++e )
+		{
+			ENSURE( repaired.GetEdge( e ).target == fresh.GetEdge( e ).target );
+			ENSURE_SMALL( repaired.GetEdge( e ).length - fresh.GetEdge( e ).length, 1e-3f );
+		}
+	}
+
+	return 0;
+}
+
+// After every edit the repaired flow fields are the fields a fresh build makes
+static int FlowFieldRepair( void )
+{
+	RandomStream random( 29 );
+	MapMaker map;
+	MakeRandomMap( map, 20, random );
+
+	for ( int edit = 0; edit < 40; ++edit )
+	{
+		EditRandomMap( map, random );
+
+		FlowFields fresh;
+		fresh.Reset( map.occupancy );
+		for ( const SampleFunctionalArea& area : map.layout )
+		{
+			fresh.AddField( AreaCells( area ) );
+		}
+
+		const FlowFields& repaired = map.flow_fields;
+		ENSURE( repaired.GetFieldCount() == fresh.GetFieldCount() );
+		for ( int field = 0; field < fresh.GetFieldCount(); ++field )
+		{
+			for ( int x = 0; x < 20; ++x )
+			{
+				for ( int y = 0; y < 20; ++y )
+				{
+					ENSURE( repaired.GetCost( field, x, y ) == fresh.GetCost( field, x, y ) );
+					ENSURE( repaired.GetDirection( field, x, y ) == fresh.GetDirection( field, x, y ) );
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+// After every edit the repaired chunks have the entrances and costs of a fresh build
+static int ChunkRepair( void )
+{
+	RandomStream random( 31 );
+	MapMaker map;
+	MakeRandomMap( map, 20, random );
+
+	for ( int edit = 0; edit < 40; ++edit )
+	{
+		EditRandomMap( map, random );
+
+		ChunkGraph fresh;
+		fresh.Build( map.occupancy, map.chunk_graph.GetChunkSize() );
+
+		const ChunkGraph& repaired = map.chunk_graph;
+		ENSURE( repaired.GetChunkCount() == fresh.GetChunkCount() );
+		for ( int i = 0; i < fresh.GetChunkCount(); ++i )
+		{
+			const ChunkGraph::Chunk& a = repaired.GetChunk( i );
+			const ChunkGraph::Chunk& b = fresh.GetChunk( i );
+			ENSURE( a.cells == b.cells );
+			ENSURE( a.links.size() == b.links.size() );
+			for ( size_t j = 0; j < b.links.size(); ++j )
+			{
+				ENSURE( a.links[j].node == b.links[j].node && a.links[j].partner == b.links[j].partner );
+			}
+			ENSURE( a.costs == b.costs );
+		}
+		for ( int cell = 0; cell < map.occupancy.GetCellCount(); ++cell )
+		{
+			ENSURE( repaired.GetSlot( cell ) == fresh.GetSlot( cell ) );
+		}
+	}
+
+	return 0;
+}
+
+// The cell below the area is walled in, the planners still reach one of its other sides
+static int SealedSide( void )
+{
+	MapMaker map;
+	map.corner_layout = { 5, 5 };
+	map.clearance = 11.0f;
+	const int cells[4][2] = { { 2, 2 }, { 1, 1 }, { 3, 1 }, { 2, 0 } };
+	for ( int i = 0; i < 4; ++i )
+	{
+		SampleFunctionalArea area;
+		area.type = 0;
+		area.orientation = 0;
+		area.x = float( cells[i][0] );
+		area.y = float( cells[i][1] );
+		map.layout.push_back( area );
+		map.cow_aabbs.push_back( map.AreaAABB( area ) );
+	}
+	map.CreateCowMap();
+	map.CreateGridMap();
+	map.CreateChunkGraph();
+	map.CreateVisibilityGraph();
+
+	// The anchor snaps to the sealed cell, the old single goal
+	int x, y;
+	ENSURE( map.occupancy.FindFreeCell( { 60.0f, 60.0f }, &x, &y ) );
+	ENSURE( x == 2 && y == 1 );
+
+	std::vector<std::pair<int, int>> goalCells;
+	map.occupancy.FindSideCells( AreaCells( map.layout[0] ), goalCells );
+	ENSURE( goalCells.size() == 4 );
+	std::vector<b2Vec2> goalPoints;
+	for ( const std::pair<int, int>& cell : goalCells )
+	{
+		goalPoints.push_back( map.occupancy.CellCenter( cell.first, cell.second ) );
+	}
+
+	PlanBudget budget;
+	budget.max_milliseconds = 0.0f;
+	b2Vec2 start = { 12.0f, 108.0f };
+	b2Vec2 sealed = map.occupancy.CellCenter( 2, 1 );
+
+	GridPlanner grid;
+	for ( int jumpPoints = 0; jumpPoints < 2; ++jumpPoints )
+	{
+		PlanResult result = grid.FindPath( start, goalCells, map.occupancy, jumpPoints == 1, budget );
+		ENSURE( result.status == plan_found );
+		ENSURE( b2Distance( result.path.back(), sealed ) > 1.0f );
+	}
+
+	HierarchicalPlanner hierarchical;
+	PlanResult result = hierarchical.FindPath( start, goalCells, map.chunk_graph, budget );
+	ENSURE( result.status == plan_found );
+	ENSURE( b2Distance( result.path.back(), sealed ) > 1.0f );
+
+	VisibilityPlanner visibility;
+	result = visibility.FindPath( start, goalPoints, map.visibility, budget );
+	ENSURE( result.status == plan_found );
+	ENSURE( b2Distance( result.path.back(), sealed ) > 1.0f );
+
+	return 0;
+}
+
+int PlannerTest( void )
+{
+	RUN_SUBTEST( OneCellAisle );
+	RUN_SUBTEST( StarCosts );
+	RUN_SUBTEST( VisibilityRepair );
+	RUN_SUBTEST( FlowFieldRepair );
+	RUN_SUBTEST( ChunkRepair );
+	RUN_SUBTEST( SealedSide );
+
+	return 0;
+}
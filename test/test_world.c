@@ -198,12 +198,131 @@ static int TestIsValid( void )
 	return 0;
 }
 
+// The bulk getters and setters agree with the single body ones, including for
+// static and sleeping bodies
+static int TestBulkBodyState( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyId bodyIds[BODY_COUNT];
+	b2Polygon square = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < BODY_COUNT; ++i )
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = i == 0 ? b2_staticBody : b2_dynamicBody;
+		bodyDef.position = ( b2Vec2 ){ 3.0f * i, 1.0f };
+		bodyDef.rotation = b2MakeRot( 0.1f * i );
+		bodyDef.linearVelocity = ( b2Vec2 ){ 0.0f, -1.0f * i };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &square );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Body_SetAwake( bodyIds[1], false );
+
+	b2Transform transforms[BODY_COUNT];
+	b2Vec2 linearVelocities[BODY_COUNT];
+	float angularVelocities[BODY_COUNT];
+	b2Body_GetTransforms( bodyIds, transforms, BODY_COUNT );
+	b2Body_GetVelocities( bodyIds, linearVelocities, angularVelocities, BODY_COUNT );
+
+	for ( int i = 0; i < BODY_COUNT; ++i )
+	{
+		b2Transform transform = b2Body_GetTransform( bodyIds[i] );
+		ENSURE( transforms[i].p.x == transform.p.x && transforms[i].p.y == transform.p.y );
+		ENSURE( transforms[i].q.c == transform.q.c && transforms[i].q.s == transform.q.s );
+
+		b2Vec2 linearVelocity = b2Body_GetLinearVelocity( bodyIds[i] );
+		ENSURE( linearVelocities[i].x == linearVelocity.x && linearVelocities[i].y == linearVelocity.y );
+		ENSURE( angularVelocities[i] == b2Body_GetAngularVelocity( bodyIds[i] ) );
+	}
+
+	// Zero keeps the sleeping body asleep, the static body takes nothing
+	for ( int i = 0; i < BODY_COUNT; ++i )
+	{
+		linearVelocities[i] = ( b2Vec2 ){ 1.0f * i, 2.0f };
+		angularVelocities[i] = 0.5f * i;
+	}
+	linearVelocities[1] = b2Vec2_zero;
+	angularVelocities[1] = 0.0f;
+	b2Body_SetVelocities( bodyIds, linearVelocities, angularVelocities, BODY_COUNT );
+
+	ENSURE( b2Body_IsAwake( bodyIds[1] ) == false );
+	ENSURE( b2Body_GetLinearVelocity( bodyIds[0] ).x == 0.0f );
+	for ( int i = 2; i < BODY_COUNT; ++i )
+	{
+		b2Vec2 linearVelocity = b2Body_GetLinearVelocity( bodyIds[i] );
+		ENSURE( linearVelocity.x == 1.0f * i && linearVelocity.y == 2.0f );
+		ENSURE( b2Body_GetAngularVelocity( bodyIds[i] ) == 0.5f * i );
+	}
+
+	// A non-zero velocity wakes the body
+	b2Vec2 push = { 0.0f, 3.0f };
+	float spin = 0.0f;
+	b2Body_SetVelocities( bodyIds + 1, &push, &spin, 1 );
+	ENSURE( b2Body_IsAwake( bodyIds[1] ) == true );
+
+	b2Body_GetVelocities( bodyIds + 1, linearVelocities, NULL, 1 );
+	ENSURE( linearVelocities[0].x == 0.0f && linearVelocities[0].y == 3.0f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Only bodies and contacts of awake islands count as awake
+static int TestAwakeCounters( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	// Two touching boxes share an island, the third is on its own
+	b2BodyId bodyIds[3];
+	b2Polygon square = b2MakeSquare( 0.5f );
+	float xs[3] = { 0.0f, 0.9f, 10.0f };
+	for ( int i = 0; i < 3; ++i )
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = b2_dynamicBody;
+		bodyDef.position = ( b2Vec2 ){ xs[i], 0.0f };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &square );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.bodyCount == 3 && counters.awakeBodyCount == 3 );
+	ENSURE( counters.contactCount == 1 && counters.awakeContactCount == 1 );
+
+	b2Body_SetAwake( bodyIds[2], false );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.awakeBodyCount == 2 && counters.awakeContactCount == 1 );
+
+	b2Body_SetAwake( bodyIds[0], false );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.bodyCount == 3 && counters.awakeBodyCount == 0 );
+	ENSURE( counters.contactCount == 1 && counters.awakeContactCount == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
 int WorldTest( void )
 {
 	RUN_SUBTEST( HelloWorld );
 	RUN_SUBTEST( EmptyWorld );
 	RUN_SUBTEST( DestroyAllBodiesWorld );
 	RUN_SUBTEST( TestIsValid );
+	RUN_SUBTEST( TestBulkBodyState );
+	RUN_SUBTEST( TestAwakeCounters );
 
 	return 0;
 }